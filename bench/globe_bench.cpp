@@ -0,0 +1,375 @@
+// globe_bench: times mesh generation and terrain mapping stages against a
+// synthetic, deterministic terrain grid, so no GEBCO download is needed.
+//
+// Build, from the repo root, with glm on the include path:
+//     g++ -std=c++20 -O2 -march=native -pthread -I. bench/globe_bench.cpp -o globe_bench
+// -march=native (or -mavx2 -mfma) selects the globe_simd.h vector kernels.
+//
+// Usage:
+//     globe_bench [--levels 1-8] [--grid 4320x8640] [--dir /tmp]
+//                 [--terrain elev.bin.npy] [--out results.jsonl] [--keep]
+//
+// Results are JSON lines, one record per (stage, level), to stdout or --out.
+// Each level also gets a record of GlobeMesh's own phase timers and
+// counters (see globe_metrics.h). Globe's console output is suppressed
+// while stages run. Files are written and read back warm, from the page cache.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+
+#include "globe.h"
+
+namespace
+{
+    struct Options
+    {
+        unsigned    level_first = 1;
+        unsigned    level_last  = 8;
+        size_t      grid_rows   = 4320;
+        size_t      grid_cols   = 8640;
+        std::string dir         = "/tmp";
+        std::string terrain;        // use this .npy instead of a synthetic grid.
+        std::string out;            // default: stdout
+        bool        keep = false;   // keep generated files.
+    };
+
+    bool parse_args(int argc, char** argv, Options& opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string_view arg = argv[i];
+            const char*      val = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (arg == "--keep")
+            {
+                opt.keep = true;
+                continue;
+            }
+            if (!val)
+            {
+                std::cerr << "Missing value for " << arg << '\n';
+                return false;
+            }
+            ++i;
+            if (arg == "--levels")
+            {
+                if (2 != sscanf(val, "%u-%u", &opt.level_first, &opt.level_last))
+                {
+                    opt.level_first = opt.level_last = (unsigned)atoi(val);
+                }
+            }
+            else if (arg == "--grid")
+            {
+                if (2 != sscanf(val, "%zux%zu", &opt.grid_rows, &opt.grid_cols))
+                {
+                    std::cerr << "--grid expects ROWSxCOLS, e.g. 4320x8640\n";
+                    return false;
+                }
+            }
+            else if (arg == "--dir")     opt.dir = val;
+            else if (arg == "--terrain") opt.terrain = val;
+            else if (arg == "--out")     opt.out = val;
+            else
+            {
+                std::cerr << "Unknown option " << arg << '\n';
+                return false;
+            }
+        }
+        return opt.level_first <= opt.level_last && opt.grid_rows && opt.grid_cols;
+    }
+
+    //-- Deterministic terrain: a few continental swells, some ridges,
+    // and hashed per-sample roughness. Roughly -7000 .. 5000 metres.
+    int16_t synthetic_elev(size_t row, size_t col, size_t rows, size_t cols)
+    {
+        const double lat = (row + 0.5) / rows * std::numbers::pi - std::numbers::pi / 2;
+        const double lon = (col + 0.5) / cols * std::numbers::pi * 2 - std::numbers::pi;
+
+        double e = 3200 * std::sin(3 * lon + 1.3 * std::sin(2 * lat)) * std::cos(2.5 * lat)
+                 + 1800 * std::sin(7 * lon) * std::sin(5 * lat)
+                 - 1500;
+        uint64_t h = (row * 0x9E3779B97F4A7C15ull) ^ (col * 0xC2B2AE3D27D4EB4Full);
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 32;
+        e += (int)(h & 255) - 128;
+        return (int16_t)std::clamp(e, -11000.0, 9000.0);
+    }
+
+    //-- Write a numpy v1 .npy file in the layout of GEBCO's elev.bin.npy:
+    // 128 byte header, then int16_t[rows][cols], South Pole first.
+    bool write_synthetic_npy(const std::string& fname, size_t rows, size_t cols)
+    {
+        std::ofstream ofs(fname, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!ofs.is_open())
+        {
+            std::cerr << "Error writing synthetic terrain file: " << fname << '\n';
+            return false;
+        }
+        std::string dict = "{'descr': '<i2', 'fortran_order': False, 'shape': (" +
+                           std::to_string(rows) + ", " + std::to_string(cols) + "), }";
+        dict.resize(128 - 10 - 1, ' ');
+        dict += '\n';
+        const uint16_t hlen = (uint16_t)dict.size();
+        ofs.write("\x93NUMPY\x01\x00", 8);
+        ofs.put((char)(hlen & 0xff)).put((char)(hlen >> 8));
+        ofs.write(dict.data(), dict.size());
+
+        std::vector<int16_t> row(cols);
+        for (size_t r = 0; r < rows; ++r)
+        {
+            for (size_t c = 0; c < cols; ++c)
+            {
+                row[c] = synthetic_elev(r, c, rows, cols);
+            }
+            ofs.write(reinterpret_cast<const char*>(row.data()), cols * sizeof(int16_t));
+        }
+        return ofs.good();
+    }
+
+    //-- Process resource counters. ru_maxrss is the lifetime peak, in KB.
+    struct Usage
+    {
+        long peak_rss_kb = 0;
+        long minor_faults = 0;
+        long major_faults = 0;
+
+        static Usage now()
+        {
+            rusage ru{};
+            getrusage(RUSAGE_SELF, &ru);
+            return { ru.ru_maxrss, ru.ru_minflt, ru.ru_majflt };
+        }
+    };
+
+    struct StageResult
+    {
+        const char* stage = "";
+        unsigned    level = 0;
+        size_t      faces = 0;      // faces at the top subdiv level
+        size_t      faces_total = 0;
+        size_t      vertices = 0;
+        size_t      bytes = 0;      // bytes produced or consumed by the stage
+        double      seconds = 0;
+        Usage       usage{};        // peak RSS after the stage, faults during it
+        bool        ok = true;
+    };
+
+    class Bench
+    {
+    private:
+        std::ostream& out;
+        std::streambuf* cout_buf = nullptr;
+        std::ofstream   null_stream{ "/dev/null" };
+
+    public:
+        Bench(std::ostream& out) : out(out) {}
+
+        //-- Run `fn` with std::cout silenced, and time it.
+        template <class Fn>
+        StageResult time(const char* stage, unsigned level, Fn&& fn)
+        {
+            StageResult res{ .stage = stage, .level = level };
+            auto before = Usage::now();
+            cout_buf = std::cout.rdbuf(null_stream.rdbuf());
+
+            auto t0 = std::chrono::steady_clock::now();
+            res.ok = fn(res);
+            auto t1 = std::chrono::steady_clock::now();
+
+            std::cout.rdbuf(cout_buf);
+            auto after = Usage::now();
+            res.seconds = std::chrono::duration<double>(t1 - t0).count();
+            res.usage = { after.peak_rss_kb,
+                          after.minor_faults - before.minor_faults,
+                          after.major_faults - before.major_faults };
+            return res;
+        }
+
+        void emit(const StageResult& r)
+        {
+            auto per = [&](size_t n) { return n ? r.seconds * 1e9 / n : 0.0; };
+            char line[768];
+            snprintf(line, sizeof(line),
+                     "{\"bench\": \"globe\", \"stage\": \"%s\", \"level\": %u, \"ok\": %s, "
+                     "\"faces\": %zu, \"faces_total\": %zu, \"vertices\": %zu, \"bytes\": %zu, "
+                     "\"seconds\": %.6f, \"ns_per_face\": %.3f, \"ns_per_vertex\": %.3f, \"gb_per_s\": %.4f, "
+                     "\"peak_rss_kb\": %ld, \"minor_faults\": %ld, \"major_faults\": %ld}",
+                     r.stage, r.level, r.ok ? "true" : "false",
+                     r.faces, r.faces_total, r.vertices, r.bytes,
+                     r.seconds, per(r.faces_total), per(r.vertices),
+                     r.seconds > 0 ? r.bytes / r.seconds / 1e9 : 0.0,
+                     r.usage.peak_rss_kb, r.usage.minor_faults, r.usage.major_faults);
+            out << line << std::endl;
+            std::cerr << std::setw(18) << r.stage << " L" << std::setw(2) << r.level << ": "
+                      << std::fixed << std::setprecision(3) << r.seconds * 1e3 << " ms"
+                      << (r.ok ? "" : "  FAILED") << '\n';
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt))
+    {
+        std::cerr << "usage: globe_bench [--levels A-B] [--grid ROWSxCOLS] [--dir DIR]"
+                     " [--terrain FILE.npy] [--out FILE] [--keep]\n";
+        return 2;
+    }
+    std::ofstream ofs;
+    if (!opt.out.empty())
+    {
+        ofs.open(opt.out, std::ios::out | std::ios::trunc);
+        if (!ofs.is_open())
+        {
+            std::cerr << "Error opening " << opt.out << '\n';
+            return 1;
+        }
+    }
+    std::ostream& out = opt.out.empty() ? std::cout : ofs;
+    Bench bench(out);
+
+    std::string terrain = opt.terrain;
+    if (terrain.empty())
+    {
+        terrain = opt.dir + "/globe_bench_terrain.npy";
+        std::cerr << "Writing synthetic " << opt.grid_rows << "x" << opt.grid_cols << " terrain to " << terrain << '\n';
+        if (!write_synthetic_npy(terrain, opt.grid_rows, opt.grid_cols))
+        {
+            return 1;
+        }
+    }
+    {   // config record, so result files are self describing.
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "{\"bench\": \"globe\", \"config\": {\"levels\": [%u, %u], \"terrain\": \"%s\", "
+                 "\"synthetic\": %s, \"grid\": [%zu, %zu], \"compiler\": \"%s\"}}",
+                 opt.level_first, opt.level_last, terrain.c_str(), opt.terrain.empty() ? "true" : "false",
+                 opt.grid_rows, opt.grid_cols, __VERSION__);
+        out << line << std::endl;
+    }
+
+    const std::string mesh_file = opt.dir + "/globe_bench_mesh.dat";
+    const std::string elev_file = opt.dir + "/globe_bench_mesh.elev";
+    bool all_ok = true;
+
+    for (unsigned level = opt.level_first; level <= opt.level_last; ++level)
+    {
+        Globe::GlobeMesh gen;
+        gen.set_verbose(false);
+        auto fill = [&](StageResult& r, const Globe::GlobeMesh& mesh)
+            {
+                r.faces = mesh.get_faces().size();
+                r.faces_total = mesh.get_faces(0).size();
+                for (size_t i = 1; i < mesh.subdiv_count(); ++i)
+                {
+                    r.faces_total += mesh.get_faces(i).size();
+                }
+                r.vertices = mesh.get_vertices().size();
+            };
+
+        auto res = bench.time("generate", level, [&](StageResult& r)
+            {
+                bool ok = gen.generate(mesh_file.c_str(), nullptr, level);
+                fill(r, gen);
+                r.bytes = r.faces_total * sizeof(Globe::Triangle) + r.vertices * sizeof(Globe::SphericalCoord);
+                return ok;
+            });
+        bench.emit(res);
+        if (!res.ok)
+        {
+            all_ok = false;
+            continue;
+        }
+
+        res = bench.time("map_elevations", level, [&](StageResult& r)
+            {
+                bool ok = gen.load_from_terrain(terrain.c_str());
+                fill(r, gen);
+                r.bytes = r.vertices * (sizeof(Globe::SphericalCoord) + sizeof(int16_t));
+                return ok;
+            });
+        bench.emit(res);
+        all_ok &= res.ok;
+
+        res = bench.time("write_elevations", level, [&](StageResult& r)
+            {
+                bool ok = gen.write_elevations(elev_file.c_str());
+                fill(r, gen);
+                r.bytes = r.vertices * sizeof(int16_t);
+                return ok;
+            });
+        bench.emit(res);
+        all_ok &= res.ok;
+
+        Globe::GlobeMesh loaded;
+        loaded.set_verbose(false);
+        res = bench.time("load_from_mesh", level, [&](StageResult& r)
+            {
+                bool ok = loaded.load_from_mesh(mesh_file.c_str());
+                fill(r, loaded);
+                return ok;
+            });
+        bench.emit(res);
+        all_ok &= res.ok;
+
+        //-- load_from_mesh() only maps the file. Touch every face and
+        // vertex to measure the actual read throughput.
+        volatile uint64_t sink = 0;
+        res = bench.time("scan_mesh", level, [&](StageResult& r)
+            {
+                uint64_t sum = 0;
+                for (auto& t : loaded.get_faces())
+                {
+                    sum += t[0] + t[1] + t[2];
+                }
+                float fsum = 0;
+                for (auto& v : loaded.get_vertices())
+                {
+                    fsum += v.pos.x + v.elev;
+                }
+                sink = sum + (uint64_t)fsum;
+                fill(r, loaded);
+                r.faces_total = r.faces;
+                r.bytes = r.faces * sizeof(Globe::Triangle) + r.vertices * sizeof(Globe::SphericalCoord);
+                return true;
+            });
+        bench.emit(res);
+
+        res = bench.time("elev_to_rgb", level, [&](StageResult& r)
+            {
+                glm::vec3 acc(0.0f);
+                for (auto& v : gen.get_vertices())
+                {
+                    acc += gen.elev_to_rgb(v.elev);
+                }
+                sink = sink + (uint64_t)(acc.r + acc.g + acc.b);
+                fill(r, gen);
+                r.faces = r.faces_total = 0;
+                r.bytes = r.vertices * (sizeof(float) + sizeof(glm::vec3));
+                return true;
+            });
+        bench.emit(res);
+
+        out << "{\"bench\": \"globe\", \"level\": " << level << ", \"metrics\": ";
+        gen.get_metrics().write_json(out) << "}" << std::endl;
+    }
+
+    if (!opt.keep)
+    {
+        std::remove(mesh_file.c_str());
+        std::remove(elev_file.c_str());
+        if (opt.terrain.empty())
+        {
+            std::remove(terrain.c_str());
+        }
+    }
+    return all_ok ? 0 : 1;
+}
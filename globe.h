@@ -8,13 +8,28 @@
 #include <cmath>
 #include <numbers>
 #include <limits>
+#include <cstddef>
 #include <cstdint>
+#include <climits>
+#include <algorithm>
 #include <utility>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stop_token>
+#include <filesystem>
 #include <ranges>
 
 #include <map>
 #include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
 
 #ifndef GLM_ENABLE_EXPERIMENTAL
 #    define GLM_ENABLE_EXPERIMENTAL
@@ -27,6 +42,21 @@
 
 #include "memmap.h"
 #include "mikey_tools.h"
+#include "globe_metrics.h"
+#include "globe_simd.h"
+#include "globe_cellid.h"
+#include "globe_connectivity.h"
+#include "globe_normals.h"
+#include "globe_pick.h"
+#include "globe_sphere.h"
+#include "globe_profile.h"
+#include "globe_bounds.h"
+#include "globe_cull.h"
+#include "globe_gltf.h"
+#include "globe_patches.h"
+#include "globe_nearest.h"
+#include "globe_shards.h"
+#include "globe_region.h"
 
 namespace Globe
 {
@@ -160,6 +190,15 @@ namespace Globe
         {
         }
 
+        //-- Position only. `uv` is left for a later batch pass, or lat_lon().
+        struct deferred_uv_t {};
+        static constexpr deferred_uv_t deferred_uv{};
+
+        SphericalCoord(const glm::vec3& p, deferred_uv_t, float r = 1.0f)
+            : pos(normalize(p)), elev(r)
+        {
+        }
+
         SphericalCoord() = default;
         ~SphericalCoord() = default;
         SphericalCoord(const SphericalCoord& other) = default;
@@ -189,6 +228,12 @@ namespace Globe
             return pos - rhs.pos;
         }
 
+        //-- lat, lon computed from `pos`, for vertices with deferred uv.
+        glm::vec2 lat_lon() const
+        {
+            return glm::vec2(std::asin(std::clamp(pos.y, -1.0f, 1.0f)), std::atan2(pos.x, pos.z));
+        }
+
         //==========
     };
 
@@ -226,9 +271,11 @@ namespace Globe
     {
     public:
         using vertex_type = VertexT;
+        using map_allocator = mhy::ArenaAllocator<std::pair<const VertexT, index_type>>;
+        using map_type = std::map<VertexT, index_type, std::less<VertexT>, map_allocator>;
 
     private:
-        std::map<VertexT, index_type> vertex_map;
+        map_type vertex_map;
         mhy::ListT<VertexT> indices;
 
     public:
@@ -239,10 +286,19 @@ namespace Globe
         VertexList& operator=(const VertexList& other) = default;
         VertexList& operator=(VertexList&& other) = default;
 
+        //-- Draw the merge map's nodes from `arena` rather than the heap.
+        // The arena must outlive this list. Any existing entries are dropped.
+        void use_arena(mhy::Arena* arena)
+        {
+            vertex_map = map_type(std::less<VertexT>(), map_allocator(arena));
+        }
+
         //==========
         uint32_t add(const VertexT& vertex)
         {
-            auto res = vertex_map.insert(std::make_pair(vertex, (uint32_t)indices.size()));
+            //-- value_type, not make_pair(): the generic insert() allocates
+            // a node before finding it is a duplicate.
+            auto res = vertex_map.insert(typename map_type::value_type(vertex, (uint32_t)indices.size()));
             if (res.second)
             {
                 indices.push_back(vertex);
@@ -279,6 +335,16 @@ namespace Globe
 
         // clang-format on
 
+        //-- Enter vertices [first, size()) into the merge map, as add()
+        // would have, for a list taken up part way.
+        void reindex(size_t first)
+        {
+            for (size_t i = first; i < indices.size(); ++i)
+            {
+                vertex_map.insert(typename map_type::value_type(indices[i], (uint32_t)i));
+            }
+        }
+
         auto find(const VertexT& vertex) const
         {
             auto it = vertex_map.find(vertex);
@@ -291,14 +357,91 @@ namespace Globe
         }
     };
 
+    //-- A loaded mesh is read only: its const members may run at once on
+    // any number of threads, and build the caches they need once, between
+    // them. publish() and attach() share one across processes.
     class GlobeMesh
     {
     public:
         typedef SphericalCoord  vertex_type;
         typedef Triangle        face_type;
+
+        //-- vertex_type records in floats, for the strided simd:: kernels.
+        static constexpr size_t vertex_stride = sizeof(vertex_type) / sizeof(float);
+        static_assert(sizeof(vertex_type) % sizeof(float) == 0
+                      && offsetof(vertex_type, uv) == 0 && offsetof(vertex_type, pos) == 2 * sizeof(float));
+
+        //-- Where the subdivs, faces and verts chunks' data lie in the loaded file.
+        struct MeshLayout
+        {
+            uint64_t subdivs_offset = 0;
+            uint64_t subdivs_count = 0;
+            uint64_t faces_offset = 0;
+            uint64_t faces_count = 0;
+            uint64_t verts_offset = 0;
+            uint64_t verts_count = 0;
+        };
+
+        //-- Where a chunk's data lies in the loaded file.
+        struct ChunkEntry
+        {
+            uint16_t chunk_type;
+            int      level;         // -1 for whole mesh chunks
+            uint32_t data_stride;
+            uint64_t data_count;
+            size_t   data_offset;
+            size_t   header_offset;
+        };
+
+        //-- A set of elevations by vertex id, float or quantized int16:
+        // offset + scale * q. Views a mapped elevation file, or `owned`
+        // samples taken from a terrain grid.
+        struct ElevationLayer
+        {
+            std::string                            name{};
+            std::unique_ptr<mhy::MemoryMappedFile> file{};
+            std::vector<int16_t>                   owned{};
+            mhy::RangeT<const float>               elevs{};   // float layers
+            mhy::RangeT<const int16_t>             quant{};   // int16 layers
+            float                                  scale = 1.0f;
+            float                                  offset = 0.0f;
+
+            bool is_quantized() const
+            {
+                return elevs.empty();
+            }
+
+            size_t size() const
+            {
+                return is_quantized() ? quant.size() : elevs.size();
+            }
+
+            float operator[](size_t vertex) const
+            {
+                return is_quantized() ? offset + scale * quant[vertex] : elevs[vertex];
+            }
+
+            //-- Elevations [first, first + n) as floats, widened by simd::.
+            void read(size_t first, size_t n, float* out) const
+            {
+                if (is_quantized())
+                {
+                    simd::widen_i16(quant.begin() + first, scale, offset, out, n);
+                }
+                else
+                {
+                    std::copy_n(elevs.begin() + first, n, out);
+                }
+            }
+        };
     private:
         std::unique_ptr<mhy::MappedBuffer>      gen_file;   // mesh wwas generated into this file
         std::unique_ptr<mhy::MemoryMappedFile>  load_file;  // pre-generated mesh was loaded from this.
+        std::unique_ptr<mhy::Arena>             scratch;    // vertex merge map nodes. Must outlive `vertices`.
+        std::vector<ChunkEntry>                 chunk_dir;  // chunks found in `load_file`
+        std::string                             load_name;  // absolute path of `load_file`
+        MeshLayout                              load_layout;
+        std::unique_ptr<mhy::SharedSegment>     published;  // see publish()
 
         VertexList<SphericalCoord, glm::vec3> vertices;
         TriangleList                          triangles;
@@ -324,10 +467,194 @@ namespace Globe
 
         mhy::ListT<SubdivLevel> subdivs;
 
+        //-- One entry per level, built at most once. A level's lock is held
+        // only while it is built; once built, the entry is published with
+        // release and read without a lock, as open_level() does. Entries
+        // never move, so references handed out stay good until clear().
+        template <class T>
+        class LevelCache
+        {
+        private:
+            struct Slot
+            {
+                T                 value;
+                std::atomic<bool> built{ false };
+                std::mutex        lock;
+            };
+            std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(max_levels);
+
+        public:
+            static constexpr size_t max_levels = CellId::max_level + 1;
+
+            //-- The entry, built by make(T&) unless it is already. make()
+            // may keep what is there, as attached from the mesh file.
+            template <class Make>
+            const T& get(int level, Make&& make)
+            {
+                static const T none;
+                if (level < 0 || (size_t)level >= max_levels)
+                {
+                    return none;
+                }
+                auto& slot = slots[level];
+                if (!slot.built.load(std::memory_order_acquire))
+                {
+                    std::lock_guard<std::mutex> lock(slot.lock);
+                    if (!slot.built.load(std::memory_order_relaxed))
+                    {
+                        make(slot.value);
+                        slot.built.store(true, std::memory_order_release);
+                    }
+                }
+                return slot.value;
+            }
+
+            //-- Build it again. Not while other threads hold it.
+            void rebuild(int level, T value)
+            {
+                if (level >= 0 && (size_t)level < max_levels)
+                {
+                    std::lock_guard<std::mutex> lock(slots[level].lock);
+                    slots[level].value = std::move(value);
+                    slots[level].built.store(true, std::memory_order_release);
+                }
+            }
+
+            //-- The entry, not yet built, for a load to attach file data to.
+            // Null for a level past max_levels.
+            T* unbuilt(int level)
+            {
+                return level >= 0 && (size_t)level < max_levels ? &slots[level].value : nullptr;
+            }
+
+            //-- Not while other threads hold entries.
+            void clear()
+            {
+                for (size_t l = 0; l < max_levels; ++l)
+                {
+                    slots[l].value = T();
+                    slots[l].built.store(false, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        //-- Per level, loaded from the mesh file or built on demand, so
+        // const members can share a mesh across threads.
+        mutable LevelCache<LevelConnectivity> connectivity;
+        mutable LevelCache<FaceBounds>        face_bounds;    // by leaf level
+        mutable LevelCache<Patches>           patch_levels;
+        mutable LevelCache<VertexGrid>        vertex_grids;
+
+        //-- Per level, loaded eLoadLazy: ELevelState bits, set under `level_lock`.
+        mutable std::vector<std::atomic<uint8_t>> level_state;
+        mutable std::mutex                        level_lock;
+
+        //-- elevation() reads the active layer, or the vertex records' own
+        // `elev` when there is none.
+        std::vector<ElevationLayer> elev_layers;
+        int                         active_elevs = -1;
+
+        std::shared_ptr<Metrics> metrics = std::make_shared<Metrics>();
+        bool verbose = true;    // informational console output. Errors are always printed.
+
+        //-- When set, subdivide() carries unit positions only. Vertices
+        // from `uv_pending` on have no lat/lon until compute_uv().
+        bool   defer_uv = false;
+        size_t uv_pending = SIZE_MAX;
+
+        //-- When not empty, subdivide() splits only the faces flagged here,
+        // by flat face index. See generate_region().
+        std::vector<char> refine_only;
+
+        //-- Progress and counters are published per batch of this many items.
+        static constexpr size_t progress_batch = 1 << 16;
+
+        //-- Builds into a file checkpoint after each level, and every so
+        // often within one. See checkpoint().
+        bool                                  gen_checkpoints = false;
+        double                                checkpoint_seconds = 60;
+        std::chrono::steady_clock::time_point last_checkpoint;
+
+        //-- A build in progress hands each finished level to `staging`. See
+        // stage_level(). `gen_stop` cancels the build.
+        struct Staging;
+        std::unique_ptr<Staging> staging;
+        std::stop_token          gen_stop;
+
+        struct cancelled : std::runtime_error
+        {
+            cancelled() : std::runtime_error("Generation cancelled.") {}
+        };
+
     public:
         GlobeMesh() = default;
         ~GlobeMesh() = default;
 
+        Metrics& get_metrics()
+        {
+            return *metrics;
+        }
+
+        //-- For a ProgressReporter, which may outlive this mesh.
+        std::shared_ptr<const Metrics> share_metrics() const
+        {
+            return metrics;
+        }
+
+        void set_verbose(bool on)
+        {
+            verbose = on;
+        }
+
+        //-- Subdivide with positions only, and fill in lat/lon afterwards
+        // in one threaded pass over the final vertex array. This takes
+        // atan2 and asin out of the vertex merge loop, where 2 of every 3
+        // candidates are duplicates. generate() and map_elevations()
+        // call compute_uv() as needed.
+        void set_defer_uv(bool on)
+        {
+            defer_uv = on;
+        }
+
+        //-- How often a build into a file checkpoints within a level. 0
+        // checkpoints only between levels.
+        void set_checkpoint_seconds(double seconds)
+        {
+            checkpoint_seconds = seconds;
+        }
+
+        bool uv_complete() const
+        {
+            return uv_pending >= vertices.get_indices().size();
+        }
+
+        //-- Fill in lat/lon for all vertices added with deferred uv.
+        void compute_uv()
+        {
+            auto& verts = vertices.get_upd_indices();
+            if (uv_complete())
+            {
+                return;
+            }
+            auto phase = metrics->phase("compute_uv", -1, verts.size() - uv_pending);
+            auto first = &verts[uv_pending];
+            mhy::parallel_for(verts.size() - uv_pending, [first](size_t begin, size_t end)
+                {
+                    simd::unit_to_lat_lon_strided(&first[begin].pos.x, vertex_stride,
+                                                  &first[begin].uv.x, vertex_stride, end - begin);
+                }, 1 << 16);
+            metrics->progress(verts.size() - uv_pending);
+            uv_pending = SIZE_MAX;
+        }
+
+        std::ostream& info() const
+        {
+            static std::ostream nowhere(nullptr);
+            return verbose ? std::cout : nowhere;
+        }
+
+        //-- Level `sub`'s vertices, the prefix its faces use; by default,
+        // the last level's. Loaded eLoadLazy, the level is opened first.
         auto get_vertices(size_t sub = UINT_MAX) const
         {
             auto& verts = vertices.get_indices();
@@ -335,6 +662,10 @@ namespace Globe
             {
                 return slice(verts, 0, 0);
             }
+            if (!open_level(sub))
+            {
+                return slice(verts, verts.size(), verts.size());   // none
+            }
             if (sub >= subdivs.size())
             {
                 return slice(verts, subdivs.back().vertices());
@@ -358,6 +689,10 @@ namespace Globe
             {
                 return slice(triangles, 0, 0);
             }
+            if (!open_level(sub))
+            {
+                return slice(triangles, triangles.size(), triangles.size());   // none
+            }
             if (sub >= subdivs.size())
             {
                 return slice(triangles, subdivs.back().faces());
@@ -365,14 +700,39 @@ namespace Globe
             return slice(triangles, subdivs[sub].faces());
         }
 
+        //-- Cell ids address faces of make_globe() meshes by level and
+        // position. See globe_cellid.h.
+        static CellId cell_of(size_t face_index)
+        {
+            return CellId::from_flat(face_index);
+        }
+
+        const Triangle& face_of(CellId cell) const
+        {
+            return triangles[cell.flat_index()];   // WARNING: No bounds checking
+        }
+
         void mark_subdiv()
         {
             auto first = !subdivs.empty() ? subdivs.back().offset_end : 0;
             subdivs.push_back({ first, triangles.size(), vertices.get_indices().size() });
         }
 
-        bool load_from_mesh(const char* fname)
+        enum ELoadMode
+        {
+            eLoadMapped,    // every level, paged in as it is touched
+            eLoadLazy,      // only the headers; each level on first use. See open_level().
+        };
+
+        //-- A globe file, or a shard manifest, whose shards are put
+        // together in memory. See merge_shards().
+        bool load_from_mesh(const char* fname, ELoadMode mode = eLoadMapped)
         {  // stubbed for now.
+            if (ShardManifest::is_manifest(fname))
+            {
+                return assemble_shards(fname, nullptr);
+            }
+            auto phase = metrics->phase("load_from_mesh");
             auto poo = std::make_unique<mhy::MemoryMappedFile>(fname);
 
             auto& fheader = *poo->cast_to<globe_fileheader>(0);    // get file header at offset 0
@@ -382,6 +742,11 @@ namespace Globe
                 std::cout << "File '" << fname << "' is not compatible with this version of Globe.\n";
                 return false;
             }
+            if (fheader.flags & eFileBuilding)
+            {
+                std::cout << "File '" << fname << "' is unfinished. Generate it again to resume.\n";
+                return false;
+            }
 
             size_t i_offset = fheader.header_bytes + fheader.data_bytes;
             auto pchunk = poo->cast_to<globe_chunk_header>(i_offset);
@@ -394,7 +759,9 @@ namespace Globe
                     return false;
                 }
             }
-            auto r_subds = mhy::range(poo->cast_to<SubdivLevel>(i_offset + pchunk->header_bytes), pchunk->data_count);
+            MeshLayout at;
+            at.subdivs_offset = i_offset + pchunk->header_bytes;
+            at.subdivs_count = pchunk->data_count;
 
             i_offset += pchunk->header_bytes + pchunk->data_size;
             pchunk = poo->cast_to<globe_chunk_header>(i_offset);
@@ -407,7 +774,8 @@ namespace Globe
                     return false;
                 }
             }
-            auto r_faces = mhy::range(poo->cast_to<Triangle>(i_offset + pchunk->header_bytes), pchunk->data_count);
+            at.faces_offset = i_offset + pchunk->header_bytes;
+            at.faces_count = pchunk->data_count;
 
             i_offset += pchunk->header_bytes + pchunk->data_size;
             pchunk = poo->cast_to<globe_chunk_header>(i_offset);
@@ -420,456 +788,3346 @@ namespace Globe
                     return false;
                 }
             }
-            auto r_verts = mhy::range(poo->cast_to<SphericalCoord>(i_offset + pchunk->header_bytes), pchunk->data_count);
-
-            subdivs.load_from(r_subds);
-            triangles.load_from(r_faces);
-            get_upd_vertices().load_from(r_verts);
-
-            load_file.swap(poo);    // assign ownership to `this`
+            at.verts_offset = i_offset + pchunk->header_bytes;
+            at.verts_count = pchunk->data_count;
 
+            i_offset += pchunk->header_bytes + pchunk->data_size;
+            if (!levels_fit(*poo, at) || !load_chunk_directory(*poo, i_offset))
+            {
+                std::cout << "File '" << fname << "' is damaged.\n";
+                return false;
+            }
+            take_up(poo, at, mode);
+            load_name = std::filesystem::absolute(fname).string();
             return true;
         }
-        //---- This is all you need to draw a globe. The remainder
-        // generates the mesh and writes the data file loaded above.
-        //--------------------------------------------------
 
-        //--------------------------------------------------
-        void make_hexcap(float lat, float lon)
+    private:
+        //-- Is the mesh the loaded file's, rather than one generated since?
+        bool is_loaded() const
         {
-            // a hex cap is a triangle fan of 6 equilateral
-            // triangles about a common point. The side lengths
-            // are half those of the base icosahedron generated
-            // in `make_globe()`.
-
-            // Construct geometry at the North Pole,
-            // then rotate them to the give lat-lon.
-            auto make_triangle = [&](SphericalCoord& a,
-                                     SphericalCoord& b,
-                                     SphericalCoord& c)
-                {
-                    triangles.push_back(vertices.add_triangle(a, b, c));
-                };
-
-            // Start by making a triangle fan of 6 about the North Pole.
-            constexpr auto pi_3 = pi / 3;   // 60 degrees
-            constexpr auto pi_6 = pi / 6;   // 30 degrees
-            constexpr auto n_lat = pi_2 - pi_6;
-
-            auto const fix_lat = pi_2 - lat;    // - n_lat / 2.0f;
-            auto const fix_lon = lon;
-            auto rot = glm::mat4(1.0f);
-            rot = glm::rotate(rot, fix_lon, { 0.0f, 1.0f, 0.0f });
-            rot = glm::rotate(rot, fix_lat, { 1.0f, 0.0f, 0.0f });
-
-            auto fix_lat_lon = [&rot](float vlat, float vlon)
-                {
-                    auto pos = glm::euclidean(glm::vec2(vlat, vlon));
-                    return SphericalCoord(rot * glm::vec4(pos, 1));
-                };
-
-            auto v0 = fix_lat_lon(pi_2, 0.0f);   // North Pole.
-            auto v1 = fix_lat_lon(n_lat, 0.0f);
-            auto v2 = fix_lat_lon(n_lat, pi_3);
-            auto v3 = fix_lat_lon(n_lat, pi_3 * 2);
-            auto v4 = fix_lat_lon(n_lat, pi_3 * 3);
-            auto v5 = fix_lat_lon(n_lat, pi_3 * 4);
-            auto v6 = fix_lat_lon(n_lat, pi_3 * 5);
-
-            make_triangle(v0, v2, v1);
-            make_triangle(v0, v3, v2);
-            make_triangle(v0, v4, v3);
-            make_triangle(v0, v5, v4);
-            make_triangle(v0, v6, v5);
-            make_triangle(v0, v1, v6);
-
-            mark_subdiv();
-
-            print(true);
-            Globe::print(get_faces(), true);
-
+            return load_file && triangles.begin() == load_file->cast_to<Triangle>(load_layout.faces_offset);
         }
-        void make_globe()
-        {
-            // Make some triangles.
 
-            const float n_lat = atan(0.5f);
-            const float s_lat = -n_lat;
-            const float wedge = pi * 0.4f;  // 72 degrees
-            float       east = wedge * 0.5f;
+        enum ELevelState : uint8_t
+        {
+            eLevelValid = 1,        // its faces' vertices are in its prefix
+            eLevelResident = 2,     // read in, and not released since
+        };
 
-            for (int i = 0; i < 5; ++i, east += wedge)
+        //-- Loaded eLoadLazy, the first use of a level reads in its faces and
+        // vertex prefix, and checks its faces against them. Levels are opened
+        // once, by whichever thread first asks. False if the level is damaged.
+        bool open_level(size_t sub) const
+        {
+            if (level_state.empty())
             {
-                auto east2 = east + wedge * 0.5f;
-                auto west = east - wedge;
-                auto mid = east2 - wedge;
-                // clockwise vertex order
-                // clang-format off
-                triangles.push_back(
-                    vertices.add_triangle(
-                        { pi_2, (east + west) * 0.5f },
-                        { n_lat, east },
-                        { n_lat, west }));
-                triangles.push_back(
-                    vertices.add_triangle(
-                        { n_lat, east },
-                        { s_lat, mid },
-                        { n_lat, west }));
-                triangles.push_back(
-                    vertices.add_triangle(
-                        { n_lat, east },
-                        { s_lat, east2 },
-                        { s_lat, mid }));
-                triangles.push_back(
-                    vertices.add_triangle(
-                        { s_lat, mid },
-                        { s_lat, east2 },
-                        { -pi_2, (mid + east2) * 0.5f }));
-                // clang-format on
+                return true;
             }
-            mark_subdiv();
-
-            print(true);
-            Globe::print(get_faces(), true);
-        }
-
-        void subdivide(int count = 1)
-        {
-            if (subdivs.empty())
+            const size_t l = std::min(sub, level_state.size() - 1);
+            constexpr uint8_t open = eLevelValid | eLevelResident;
+            if (level_state[l].load(std::memory_order_acquire) == open)
             {
-                return;  // don't have anything to subdivide. make a globe first.
+                return true;
             }
-            for (int i = (int)subdivs.size() - 1; i < count; ++i)
+            std::lock_guard<std::mutex> lock(level_lock);
+            const uint8_t state = level_state[l].load(std::memory_order_relaxed);
+            if (state == open || !is_loaded())
             {
-                auto old_triangles = slice(triangles, subdivs.back().faces());
-                for (auto t : old_triangles)
+                return true;
+            }
+            auto phase = metrics->phase("open_level");
+            auto& level = subdivs[l];
+            load_file->prefault(false, load_layout.faces_offset + level.offset_begin * sizeof(Triangle),
+                                (level.offset_end - level.offset_begin) * sizeof(Triangle));
+            load_file->prefault(false, load_layout.verts_offset, level.vertex_end * sizeof(SphericalCoord));
+            if (!(state & eLevelValid))
+            {
+                std::atomic<bool> bad = false;
+                const uint32_t vert_end = (uint32_t)level.vertex_end;
+                mhy::parallel_for(level.offset_end - level.offset_begin, [&](size_t begin, size_t end)
+                    {
+                        for (size_t i = level.offset_begin + begin; i < level.offset_begin + end; ++i)
+                        {
+                            auto& t = triangles[i];
+                            if (t[0] >= vert_end || t[1] >= vert_end || t[2] >= vert_end)
+                            {
+                                bad = true;
+                                return;
+                            }
+                        }
+                    }, 1 << 16);
+                if (bad)
                 {
-                    auto& v0 = vertices[t[0]];
-                    auto& v1 = vertices[t[1]];
-                    auto& v2 = vertices[t[2]];
-                    auto   v01 = (v0 + v1) / 2;
-                    auto   v12 = (v1 + v2) / 2;
-                    auto   v20 = (v2 + v0) / 2;
-
-                    // std::cout << "In: {" << v0 << v1 << v2 << "}\n";
-                    // std::cout << "Out: {" << v01 << v12 << v20 << "}\n";
-
-                    auto i01 = vertices.add(v01);
-                    auto i12 = vertices.add(v12);
-                    auto i20 = vertices.add(v20);
-                    triangles.push_back({ t[0], i01, i20 });
-                    triangles.push_back({ i01, t[1], i12 });
-                    triangles.push_back({ i20, i12, t[2] });
-                    triangles.push_back({ i01, i12, i20 });
+                    std::cout << "Level " << l << " of '" << load_name << "' has faces past its vertices.\n";
+                    return false;
                 }
-                mark_subdiv();
-                std::cout << (i + 1) << ' ' << std::flush;
             }
-            print(false);
-            Globe::print(get_faces(), false);
+            level_state[l].store(open, std::memory_order_release);
+            return true;
         }
 
-        void print(bool details = false) const
+        //-- Each level's faces and vertex prefix lie within the file's, in order.
+        static bool levels_fit(mhy::MemoryMappedFile& file, const MeshLayout& at)
         {
-            auto& indices = vertices.get_indices();
-            std::cout << "Vertices: [" << indices.size() << "], Faces: [" << triangles.size() << "] in "
-                << subdivs.size() << " subdivs:\n";
-            for (auto ss : subdivs)
+            if (at.faces_offset + at.faces_count * sizeof(Triangle) > file.size() ||
+                at.verts_offset + at.verts_count * sizeof(SphericalCoord) > file.size() ||
+                at.subdivs_offset + at.subdivs_count * sizeof(SubdivLevel) > file.size())
             {
-                auto s = ss.faces();
-                std::cout << std::setw(16) << (s.second - s.first) << " [" << s.first << ", " << s.second << "]\n";
+                return false;
             }
-            if (details && indices.size() < 100)
+            auto levels = file.cast_to<const SubdivLevel>(at.subdivs_offset);
+            size_t faces = 0, verts = 0;
+            for (size_t l = 0; l < at.subdivs_count; ++l)
             {
-                for (size_t i = 0; i < indices.size(); ++i)
+                auto& sub = levels[l];
+                if (sub.offset_begin != faces || sub.offset_end < sub.offset_begin || sub.vertex_end < verts)
                 {
-                    const auto& v = indices[i];
-                    std::cout << std::setw(8) << i << ": " << v << std::endl;
+                    return false;
                 }
+                faces = sub.offset_end;
+                verts = sub.vertex_end;
             }
+            return faces <= at.faces_count && verts <= at.verts_count;
         }
 
-        // uv contains lat, lon in radians.
-        // lat is in [-pi/2, pi/2]
-        // lon is in [-pi, pi]
-        // normalize both to [0, 1]
-        static auto map_uv(const glm::vec2& v)
+        //-- The mesh and chunks of a validated file, at `at` and in `chunk_dir`.
+        void take_up(std::unique_ptr<mhy::MemoryMappedFile>& poo, const MeshLayout& at, ELoadMode mode)
         {
-            return glm::vec2(v.x / pi + 0.5f, v.y / pi2 + 0.5f);
+            subdivs.load_from(mhy::range(poo->cast_to<SubdivLevel>(at.subdivs_offset), at.subdivs_count));
+            triangles.load_from(mhy::range(poo->cast_to<Triangle>(at.faces_offset), at.faces_count));
+            get_upd_vertices().load_from(mhy::range(poo->cast_to<SphericalCoord>(at.verts_offset), at.verts_count));
+            connectivity.clear();
+            face_bounds.clear();
+            patch_levels.clear();
+            vertex_grids.clear();
+            for (auto& entry : chunk_dir)
+            {
+                attach_level_chunk(*poo, entry);
+            }
+            if (mode == eLoadLazy)
+            {
+                poo->random_access();
+            }
+            level_state = std::vector<std::atomic<uint8_t>>(mode == eLoadLazy ? subdivs.size() : 0);
+            load_layout = at;
+            load_file.swap(poo);    // assign ownership to `this`
+            metrics->add(eCountBytesMapped, load_file->size());
         }
 
-        static size_t index_of(float v, size_t max)
+        //-- The segment publish() leaves for attach(): the file, as it was
+        // when validated, and where its chunks lie. ChunkEntry records follow.
+        struct globe_shared_header
         {
-            auto idx = v * max - 1;
-            return idx > 0.0f ? static_cast<size_t>(idx) : 0;
-        }
+            uint32_t   magic = 0;           // shared_magic, written last
+            uint32_t   version = 1;
+            uint64_t   file_bytes = 0;
+            int64_t    file_time = 0;       // last write, as std::filesystem has it
+            MeshLayout layout;
+            uint64_t   chunk_count = 0;
+            char       path[4096] = {};
+        };
+        static constexpr uint32_t shared_magic = 0x62756c47;   // "Glub"
 
-        void map_elevations(const int16_t data[43200][86400])
+        static int64_t file_time(const std::string& path, std::error_code& err)
         {
-            auto& verts = get_upd_vertices();
-            int    i = 0;
-            for (auto& v : verts)
-            {
-                auto uv = map_uv(v.uv);
-                auto lat = index_of(uv.x, 43200);
-                auto lon = index_of(uv.y, 86400);
-                auto elev = static_cast<float>(data[lat][lon]);
-                v.elev = elev;
-
-                if ((i < 50) || (0 == i % 1000))
-                {
-                    std::cout << '.' << std::flush;
-                    // std::cout << std::setw( 8 ) << i << ": "
-                    //           << "xy" << v.uv << " uv" << uv << " index[" << lat << ", " << lon << "] -> " << elev
-                    //           << "\n";
-                }
-                ++i;
-            }
+            return std::filesystem::last_write_time(path, err).time_since_epoch().count();
         }
 
-        bool load_from_terrain(const char* dat_name)
+    public:
+        enum EShareFlags : unsigned
         {
-            mhy::MemoryMappedFile terrain(dat_name);
-            if (!terrain)
+            eShareNone = 0,
+            eSharePrefault = 1,     // read the whole file in now
+            eShareLock = 2,         // and keep it resident, for every process. See RLIMIT_MEMLOCK.
+        };
+
+        //-- Publish the loaded mesh as `name`, for other processes to attach()
+        // to without validating it again. They map the same file, so share
+        // its page cache; `flags` read it all in, and keep it there, once
+        // for all of them. The segment lasts until unpublish(name), or on
+        // Windows, while this mesh does. Publishing again replaces it;
+        // processes attached to the old one are not disturbed.
+        bool publish(const char* name, unsigned flags = eShareNone)
+        {
+            if (!is_loaded())
             {
-                std::cout << "Error opening terrain data file: " << dat_name << '\n';
+                std::cout << "publish(): only a mesh loaded by load_from_mesh() can be published.\n";
                 return false;
             }
-            typedef int16_t lat_row[86400];
-            typedef lat_row grid[43200];
-            auto            data = terrain.cast_to<lat_row>(0200);
-            const auto      sgrid = sizeof(lat_row) * 43200;  // sizeof(grid);
-            const auto      tsize = terrain.size() - 0200;
-            if (sgrid != tsize)
+            auto phase = metrics->phase("publish");
+            globe_shared_header hdr;
+            std::error_code err;
+            hdr.file_bytes = load_file->size();
+            hdr.file_time = file_time(load_name, err);
+            hdr.layout = load_layout;
+            hdr.chunk_count = chunk_dir.size();
+            if (err || load_name.size() >= sizeof(hdr.path))
             {
-                std::cout << "Terrain data file mismatch. Expect " << sgrid << " bytes, got " << tsize << std::endl;
+                std::cout << "publish(): cannot publish '" << load_name << "'.\n";
+                return false;
+            }
+            std::copy(load_name.begin(), load_name.end(), hdr.path);
+            if (flags & (eSharePrefault | eShareLock))
+            {
+                load_file->prefault(flags & eShareLock);
+            }
+
+            published.reset();     // on Windows, its name goes with our handle.
+            auto seg = std::make_unique<mhy::SharedSegment>(name, sizeof(hdr) + sizeof(ChunkEntry) * chunk_dir.size());
+            if (!*seg)
+            {
+                std::cout << "publish(): could not create shared segment '" << name << "'.\n";
                 return false;
             }
-            map_elevations(data);
+            *seg->cast_to<globe_shared_header>(0) = hdr;
+            std::copy(chunk_dir.begin(), chunk_dir.end(), seg->cast_to<ChunkEntry>(sizeof(hdr)));
+            std::atomic_thread_fence(std::memory_order_release);
+            seg->cast_to<globe_shared_header>(0)->magic = shared_magic;
+            published.swap(seg);
             return true;
         }
 
-        bool write_elevations(const char* fname)
+        static bool unpublish(const char* name)
         {
-            std::ofstream ofs(fname, std::ios::binary | std::ios::out | std::ios::trunc);
-            if (!ofs.is_open())
+            return mhy::SharedSegment::remove(name);
+        }
+
+        //-- Load the mesh published as `name`: map its file, and take the
+        // publisher's word for its layout. Fails if the file has changed.
+        bool attach(const char* name, ELoadMode mode = eLoadMapped)
+        {
+            auto phase = metrics->phase("attach");
+            mhy::SharedSegment seg(name);
+            auto hdr = seg.cast_to<const globe_shared_header>(0);
+            if (!seg || seg.size() < sizeof(globe_shared_header) || hdr->magic != shared_magic || hdr->version != 1 ||
+                seg.size() < sizeof(globe_shared_header) + sizeof(ChunkEntry) * hdr->chunk_count)
             {
-                std::cout << "Error writing terrain elevations file: " << fname << std::endl;
+                std::cout << "No globe is published as '" << name << "'.\n";
                 return false;
             }
-            auto       verts = get_vertices();
-            const auto vsize = verts.size();
-
-            using ElevList = std::vector<float>;
-            ElevList elevs;
-            elevs.reserve(verts.size());
-
-            for (auto& vert : verts)
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::string path(hdr->path, strnlen(hdr->path, sizeof(hdr->path)));
+            std::error_code err;
+            const auto bytes = std::filesystem::file_size(path, err);
+            if (err || bytes != hdr->file_bytes || file_time(path, err) != hdr->file_time || err)
             {
-                elevs.push_back(vert.elev);
+                std::cout << "Globe file '" << path << "' has changed since it was published as '" << name << "'.\n";
+                return false;
             }
-            const auto esize = elevs.size();
-            ofs.write(reinterpret_cast<const char*>(elevs.data()), elevs.size() * sizeof(ElevList::value_type));
-
-            ofs.close();
-            std::cout << "Wrote " << verts.size() << " elevs to: " << fname << std::endl;
+            auto poo = std::make_unique<mhy::MemoryMappedFile>(path.c_str());
+            if (!*poo || poo->size() != hdr->file_bytes)
+            {
+                std::cout << "Could not map globe file '" << path << "'.\n";
+                return false;
+            }
+            auto entries = seg.cast_to<const ChunkEntry>(sizeof(globe_shared_header));
+            chunk_dir.assign(entries, entries + hdr->chunk_count);
+            take_up(poo, hdr->layout, mode);
+            load_name = path;
             return true;
         }
 
-        bool load_elevations(const char* fname)
+        //-- Loaded eLoadLazy, let go of levels `first` and above: their faces,
+        // and the vertices they add, are dropped from memory, to be read in
+        // again if used. Safe while other threads read them, which only
+        // costs them the reads.
+        void release_levels(size_t first)
         {
-            mhy::MemoryMappedFile elves(fname);
-            if (!elves)
+            std::lock_guard<std::mutex> lock(level_lock);
+            if (!is_loaded() || first >= level_state.size())
             {
-                std::cout << "Error reading terrain elevations file: " << fname << std::endl;
-                return false;
+                return;
             }
-
-            //-- sanity check: file size and globe-mesh must
-            // agree on elev data count.
-            auto& verts = get_upd_vertices();
-            if (elves.size() != verts.size() * sizeof(float))
+            const size_t vert_first = first ? subdivs[first - 1].vertex_end : 0;
+            auto& sub = subdivs.back();
+            load_file->release(load_layout.faces_offset + subdivs[first].offset_begin * sizeof(Triangle),
+                               (sub.offset_end - subdivs[first].offset_begin) * sizeof(Triangle));
+            load_file->release(load_layout.verts_offset + vert_first * sizeof(SphericalCoord),
+                               (sub.vertex_end - vert_first) * sizeof(SphericalCoord));
+            for (size_t l = first; l < level_state.size(); ++l)
             {
-                std::cout << "load_elevations(): file size mismatch. File size: " << elves.size()
-                    << ", GlobeMesh expecting " << (verts.size() * sizeof(float)) << " bytes.\n";
-                return false;
+                level_state[l].fetch_and(uint8_t(~eLevelResident), std::memory_order_release);
             }
-            // std::vector<float> elevs;
-            // elevs.reserve(verts.size());
+        }
 
-            auto elev = elves.cast_to<float>();
-            for (auto& v : verts)
+        //-- Any chunks after the vertices, up to the EOF chunk. A later
+        // chunk of the same type and level supersedes an earlier one.
+        bool load_chunk_directory(mhy::MemoryMappedFile& file, size_t i_offset)
+        {
+            chunk_dir.clear();
+            while (i_offset + sizeof(globe_chunk_header) <= file.size())
             {
-                v.elev = *elev++;
+                auto pchunk = file.cast_to<globe_chunk_header>(i_offset);
+                if (pchunk->chunk_type == eChunkEOF)
+                {
+                    return true;
+                }
+                if (pchunk->header_bytes < sizeof(globe_chunk_header) ||
+                    i_offset + pchunk->header_bytes + pchunk->data_size > file.size())
+                {
+                    std::cout << "Chunk [" << pchunk->chunk_type << "] at offset " << i_offset
+                        << " runs past the end of the file.\n";
+                    return false;
+                }
+                int level = -1;
+                if (is_level_chunk(pchunk->chunk_type) && pchunk->header_bytes >= sizeof(globe_level_chunk_header))
+                {
+                    level = (int)file.cast_to<globe_level_chunk_header>(i_offset)->level;
+                }
+                chunk_dir.push_back({ pchunk->chunk_type, level, pchunk->data_stride,
+                                      pchunk->data_count, i_offset + pchunk->header_bytes, i_offset });
+                i_offset += pchunk->header_bytes + pchunk->data_size;
             }
+            //-- Files from before the EOF chunk was written end here.
             return true;
         }
 
-        glm::vec3 elev_to_rgb(float elev)
+        void attach_level_chunk(mhy::MemoryMappedFile& file, const ChunkEntry& entry)
         {
-            using glm::vec3;
-            using HSV = vec3;
-            auto lerp_rgb = [](float val, const HSV& a, const HSV b, float v1, float v2) -> HSV
+            if (entry.level < 0 || entry.level >= (int)subdivs.size())
+            {
+                return;
+            }
+            auto pconn = connectivity.unbuilt(entry.level);
+            if (!pconn)
+            {
+                return;
+            }
+            auto& conn = *pconn;
+            auto view = [&](auto& range)
                 {
-                    float t = (val - v1) / (v2 - v1);
-                    float h = std::lerp(a.r, b.r, t);
-                    float s = std::lerp(a.g, b.g, t);
-                    float v = std::lerp(a.b, b.b, t);
-
-                    // hsv to rgb
-                    if (s == 0.0)
+                    using T = typename std::remove_reference_t<decltype(range)>::value_type;
+                    if (entry.data_stride != sizeof(T))
                     {
-                        const HSV gray{ 0.0f, 0.0f, v };
-                        return gray;
-                    }
-
-                    {  // scope name conflicts
-                        h = fmod(h, 360.0f);
-                        h /= 60.0f;
-                        int   i = (int)floor(h);
-                        float f = h - i;
-                        float p = v * (1 - s);
-                        float q = v * (1 - f * s);
-                        float t = v * (1 - (1 - f) * s);
-
-                        switch (i)
-                        {
-                        case 0: return HSV(v, t, p);  // r = v; g = t; b = p; break;
-                        case 1: return { q, v, p };     // r = q; g = v; b = p; break;
-                        case 2: return { p, v, t };     // r = p; g = v; b = t; break;
-                        case 3: return { p, q, v };     // r = p; g = q; b = v; break;
-                        case 4: return { t, p, v };     // r = t; g = p; b = v; break;
-                        default: return { v, p, q };     // r = v; g = p; b = q; break;
-                        }
+                        std::cout << "Chunk [" << entry.chunk_type << "] data_stride " << entry.data_stride
+                            << " does not match its struct size (" << sizeof(T) << ").\n";
+                        return;
                     }
+                    range = mhy::range(file.cast_to<T>(entry.data_offset), entry.data_count);
+                    conn.level = entry.level;
                 };
-            // terrain elevation selects a vertex color as follows:
-            //  0..500m     : hsv(117, 92%, 36%) : hsv(88, 28%, 56%) :
-            // 500..1200m   :    ... hsv(182, 49%, 94%)
-            //   > 1200m    :   hsv(0, 0, 99)
-            // deep rich green: hsv(117, 92%, 36%)
-            // high altitude faded green: hsv(88, 28%, 56%)
-            // h > 500m :  hsv(182, 49%, 94%)
-            //  .. 1200m: hsv(206, 13%, 95%)
-            const vec3 low_land{ 117.0f, 0.92f, 0.36f };
-            const vec3 plains{ 88.0f, 0.28f, 0.56f };
-            const vec3 glacier{ 182.0f, 0.49f, 0.94f };
-            const vec3 above{ 0.90f, 0.90f, 0.95f };  // in RGB. We return this directly.
-            // 0..2000m : hsv(258, 6%, 94%) .. hsv(232, 77%, 48%)
-            //  deeper  :     hsv(240, 66%, 17%)
-            // beach  0m   : hsv(258, 6%, 94%)
-            // deep ocean .. 2000m: hsv(232, 77%, 48%)
-            const vec3 beach{ 258.0f, 0.06f, 0.72f };
-            const vec3 deep(232.0f, 0.77f, 0.22f);
-            const vec3 too_deep{ 240.0f, 0.66f, 0.17f };
-            // ocean:
-            const float sealevel = -0;
-            if (elev < sealevel)
+            switch (entry.chunk_type)
             {
-                return lerp_rgb(elev, beach, deep, sealevel, -7000);
+            case eChunkFaceAdjacency: view(conn.adjacency); break;
+            case eChunkRingOffsets:   view(conn.ring_offsets); break;
+            case eChunkRingFaces:     view(conn.ring_faces); break;
+            case eChunkEdges:         view(conn.edges); break;
+            case eChunkFaceBounds:    attach_face_bounds(file, entry); break;
+            case eChunkPatchOffsets:
+            case eChunkPatchVerts:
+            case eChunkPatchFaces:    attach_patches(file, entry); break;
+            case eChunkGridOffsets:
+            case eChunkGridVerts:
+            case eChunkGridCones:     attach_vertex_grid(file, entry); break;
+            default: break;
             }
-            // land:
-            if (elev < 2000)
+        }
+
+        void attach_face_bounds(mhy::MemoryMappedFile& file, const ChunkEntry& entry)
+        {
+            if (entry.data_stride != sizeof(FaceBound) ||
+                entry.data_count != subdivs[entry.level].offset_end ||
+                entry.data_offset - entry.header_offset < sizeof(globe_level_chunk_header) + sizeof(globe_face_bounds_ext))
             {
-                return lerp_rgb(elev, low_land, plains, sealevel, 2000);
+                std::cout << "Face bounds chunk for level " << entry.level << " does not match the mesh.\n";
+                return;
             }
-            if (elev < 5000)
+            auto ext = file.cast_to<const globe_face_bounds_ext>(entry.header_offset + sizeof(globe_level_chunk_header));
+            auto& fb = *face_bounds.unbuilt(entry.level);
+            fb = {};
+            fb.leaf_level = entry.level;
+            fb.leaf_sag = ext->leaf_sag;
+            fb.bounds = mhy::range(file.cast_to<const FaceBound>(entry.data_offset), entry.data_count);
+        }
+
+        //-- One of a level's three patch chunks. The level's patches are
+        // whole once all three are.
+        void attach_patches(mhy::MemoryMappedFile& file, const ChunkEntry& entry)
+        {
+            auto& p = *patch_levels.unbuilt(entry.level);
+            p.level = entry.level;
+            p.face_begin = subdivs[entry.level].offset_begin;
+            switch (entry.chunk_type)
             {
-                return lerp_rgb(elev, plains, glacier, 2000, 5000);
+            case eChunkPatchOffsets:
+                if (entry.data_stride == sizeof(uint32_t) &&
+                    entry.data_offset - entry.header_offset >= sizeof(globe_level_chunk_header) + sizeof(globe_patches_ext))
+                {
+                    p.depth = file.cast_to<const globe_patches_ext>(entry.header_offset + sizeof(globe_level_chunk_header))->depth;
+                    p.offsets = mhy::range(file.cast_to<const uint32_t>(entry.data_offset), entry.data_count);
+                }
+                break;
+            case eChunkPatchVerts:
+                if (entry.data_stride == sizeof(uint32_t))
+                {
+                    p.vertex_ids = mhy::range(file.cast_to<const uint32_t>(entry.data_offset), entry.data_count);
+                }
+                break;
+            case eChunkPatchFaces:
+                if (entry.data_stride == sizeof(PatchFace) &&
+                    entry.data_count == subdivs[entry.level].offset_end - subdivs[entry.level].offset_begin)
+                {
+                    p.faces = mhy::range(file.cast_to<const PatchFace>(entry.data_offset), entry.data_count);
+                }
+                break;
+            default:
+                break;
             }
-            return above;
         }
 
-    public:
-        struct globe_fileheader
+        //-- One of a level's three vertex grid chunks.
+        void attach_vertex_grid(mhy::MemoryMappedFile& file, const ChunkEntry& entry)
         {
-            uint16_t id_word = 0x1234;
-            uint16_t header_bytes = 16;
-            uint32_t version_id = 0x0100;
-            uint32_t data_bytes = 0;
-            uint32_t padding = 0;
-        };
+            auto& g = *vertex_grids.unbuilt(entry.level);
+            g.level = entry.level;
+            switch (entry.chunk_type)
+            {
+            case eChunkGridOffsets:
+                if (entry.data_stride == sizeof(uint32_t) &&
+                    entry.data_offset - entry.header_offset >= sizeof(globe_level_chunk_header) + sizeof(globe_vertex_grid_ext))
+                {
+                    g.bucket_level = file.cast_to<const globe_vertex_grid_ext>(entry.header_offset + sizeof(globe_level_chunk_header))->bucket_level;
+                    g.offsets = mhy::range(file.cast_to<const uint32_t>(entry.data_offset), entry.data_count);
+                }
+                break;
+            case eChunkGridVerts:
+                if (entry.data_stride == sizeof(uint32_t))
+                {
+                    g.vertex_ids = mhy::range(file.cast_to<const uint32_t>(entry.data_offset), entry.data_count);
+                }
+                break;
+            case eChunkGridCones:
+                if (entry.data_stride == sizeof(VertexCone))
+                {
+                    g.cones = mhy::range(file.cast_to<const VertexCone>(entry.data_offset), entry.data_count);
+                }
+                break;
+            default:
+                break;
+            }
+        }
 
-        struct globe_chunk_header
+        //-- The last chunk of `chunk_type` for `level` in the loaded file, or null.
+        const ChunkEntry* find_chunk(uint16_t chunk_type, int level = -1) const
         {
-            uint16_t chunk_type = 0;
-            uint16_t header_bytes = 16;
-            uint32_t data_stride = 0;
-            uint64_t data_count = 0;
-            uint64_t data_size = 0;
-        };
+            for (auto it = chunk_dir.rbegin(); it != chunk_dir.rend(); ++it)
+            {
+                if (it->chunk_type == chunk_type && it->level == level)
+                {
+                    return &*it;
+                }
+            }
+            return nullptr;
+        }
 
-    private:
-        auto write_file_header(mhy::MappedBuffer& mbuf)
+        //-- `level`, or the finest level if it is out of range.
+        int level_or_finest(int level) const
         {
-            static const globe_fileheader header = {
-                .id_word = 0x1234,
-                .header_bytes = sizeof(globe_fileheader),
-                .version_id = 0x0100,
-            };
-            auto phdr = mbuf.cast_to<globe_fileheader>(0);
-            *phdr = header;
-            return mhy::RangeT<globe_fileheader>(phdr, 1);
+            return level < 0 || level >= (int)subdivs.size() ? (int)subdivs.size() - 1 : level;
         }
 
-        enum EChunkType : uint16_t
-        {
-            eChunkInvalid = 0,
-            eChunkSubdivInfo,
-            eChunkFaces,
-            eChunkVerts,
-            eChunkElevs,
-            //-----
-            eChunkEOF = 0xffff
-        };
-        std::ostream& print(std::ostream& os, const globe_chunk_header& chunk)
+        //-- True for meshes from make_globe(), which CellId can address.
+        bool is_icosahedral() const
         {
-            os << "Chunk Header: \n"
-                "    chunk_type   = " << chunk.chunk_type << "\n"
-                "    header_bytes = " << chunk.header_bytes << "\n"
-                "    data_stride  = " << chunk.data_stride << "\n"
-                "    data_count   = " << chunk.data_count << "\n"
-                "    data_size    = " << chunk.data_size << "\n"
-                ;
-            return os;
+            return !subdivs.empty() && subdivs[0].offset_end - subdivs[0].offset_begin == CellId::base_count &&
+                   !is_regional();
         }
 
-        template <class T, class U>
-        auto next_chunk(mhy::RangeT<U>& prev_chunk, size_t n = 1)
+        //-- Levels past the first hold only some children of the level
+        // before, as from generate_region().
+        bool is_regional() const
         {
-            return mhy::RangeT<T>(reinterpret_cast<T*>(prev_chunk.end()), n);
+            for (size_t l = 1; l < subdivs.size(); ++l)
+            {
+                if (subdivs[l].offset_end - subdivs[l].offset_begin != 4 * (subdivs[l - 1].offset_end - subdivs[l - 1].offset_begin))
+                {
+                    return true;
+                }
+            }
+            return false;
         }
 
-        template <class T, class U>
-        auto allocate_data_chunk(mhy::RangeT<U> prev_chunk, EChunkType etype, size_t count)
+        //-- The hierarchy walks find a face's children at 4 times its index.
+        bool has_full_levels(const char* what) const
         {
-            auto hdr = next_chunk<globe_chunk_header>(prev_chunk);
-            *hdr = { .chunk_type = etype,
-                         .header_bytes = sizeof(globe_chunk_header),
-                         .data_stride = sizeof(T),
-                         .data_count = (uint32_t)count,
-                         .data_size = sizeof(T) * count };
-            return next_chunk<T>(hdr, count);
+            if (is_regional())
+            {
+                std::cout << what << " needs every face of each level. This mesh is regional.\n";
+                return false;
+            }
+            return true;
         }
 
-        template <class U>
-        auto write_eof_chunk(mhy::RangeT<U> prev_chunk)
+        //-- Face adjacency, one-ring and edges of `level` (default, the finest),
+        // as loaded from the mesh file, or built now and kept.
+        const LevelConnectivity& get_connectivity(int level = -1) const
         {
-            return allocate_data_chunk<char>(prev_chunk, eChunkEOF, 0);
+            static const LevelConnectivity none;
+            if (subdivs.empty())
+            {
+                return none;
+            }
+            level = level_or_finest(level);
+            return connectivity.get(level, [&](LevelConnectivity& conn)
+                {
+                    if (!conn)
+                    {
+                        build_connectivity(level, conn);
+                    }
+                });
         }
 
-        void update_vertex_counts()
+        void build_connectivity(int level, LevelConnectivity& conn) const
         {
-            auto& mbuf = *gen_file;    // fixup the mapped buffer data-chunks.
+            auto faces = get_faces(level);
+            auto phase = metrics->phase("build_connectivity", level, faces.size());
+            const Triangle* pfaces = faces.begin();
+            const size_t nfaces = faces.size();
+            auto store = std::make_unique<LevelConnectivity::Storage>();
+            if (!connectivity::build_one_ring(pfaces, nfaces, subdivs[level].vertex_end,
+                                              store->ring_offsets, store->ring_faces))
+            {
+                return;
+            }
+            store->adjacency.resize(nfaces);
+            if (is_icosahedral())
+            {
+                connectivity::build_adjacency(level, nfaces, store->adjacency.data());
+            }
+            else
+            {
+                connectivity::build_adjacency(pfaces, nfaces, store->ring_offsets.data(),
+                                              store->ring_faces.data(), store->adjacency.data());
+            }
+            connectivity::build_edges(pfaces, nfaces, store->adjacency.data(), store->edges);
+            conn.level = level;
+            conn.owned = std::move(store);
+            conn.use_owned();
+            metrics->progress(nfaces);
+        }
 
-            auto const verts_count = get_vertices().size();
-            auto const faces_count = triangles.size();
-            auto const subds_count = subdiv_count();
+        //---- This is all you need to draw a globe. The remainder
+        // generates the mesh and writes the data file loaded above.
+        //--------------------------------------------------
 
-            //-- get file header
-            auto   phdr = mbuf.cast_to<globe_fileheader>(0);
-            auto   chunk = mbuf.cast_to<globe_chunk_header>();
-            size_t iOffset = phdr->header_bytes;
+        //--------------------------------------------------
+        void make_hexcap(float lat, float lon)
+        {
+            // a hex cap is a triangle fan of 6 equilateral
+            // triangles about a common point. The side lengths
+            // are half those of the base icosahedron generated
+            // in `make_globe()`.
+
+            // Construct geometry at the North Pole,
+            // then rotate them to the give lat-lon.
+            auto make_triangle = [&](SphericalCoord& a,
+                                     SphericalCoord& b,
+                                     SphericalCoord& c)
+                {
+                    triangles.push_back(vertices.add_triangle(a, b, c));
+                };
+
+            // Start by making a triangle fan of 6 about the North Pole.
+            constexpr auto pi_3 = pi / 3;   // 60 degrees
+            constexpr auto pi_6 = pi / 6;   // 30 degrees
+            constexpr auto n_lat = pi_2 - pi_6;
+
+            auto const fix_lat = pi_2 - lat;    // - n_lat / 2.0f;
+            auto const fix_lon = lon;
+            auto rot = glm::mat4(1.0f);
+            rot = glm::rotate(rot, fix_lon, { 0.0f, 1.0f, 0.0f });
+            rot = glm::rotate(rot, fix_lat, { 1.0f, 0.0f, 0.0f });
+
+            auto fix_lat_lon = [&rot](float vlat, float vlon)
+                {
+                    auto pos = glm::euclidean(glm::vec2(vlat, vlon));
+                    return SphericalCoord(rot * glm::vec4(pos, 1));
+                };
+
+            auto v0 = fix_lat_lon(pi_2, 0.0f);   // North Pole.
+            auto v1 = fix_lat_lon(n_lat, 0.0f);
+            auto v2 = fix_lat_lon(n_lat, pi_3);
+            auto v3 = fix_lat_lon(n_lat, pi_3 * 2);
+            auto v4 = fix_lat_lon(n_lat, pi_3 * 3);
+            auto v5 = fix_lat_lon(n_lat, pi_3 * 4);
+            auto v6 = fix_lat_lon(n_lat, pi_3 * 5);
+
+            make_triangle(v0, v2, v1);
+            make_triangle(v0, v3, v2);
+            make_triangle(v0, v4, v3);
+            make_triangle(v0, v5, v4);
+            make_triangle(v0, v6, v5);
+            make_triangle(v0, v1, v6);
+
+            mark_subdiv();
+            metrics->add(eCountFacesEmitted, 6);
+            metrics->add(eCountVertsAdded, vertices.get_indices().size());
+        }
+        //-- The icosahedron, or for a shard, its base faces
+        // [first_base, first_base + base_count).
+        void make_globe(unsigned first_base = 0, unsigned base_count = CellId::base_count)
+        {
+            auto phase = metrics->phase("make_globe", 0, base_count);
+            // Make some triangles.
+            unsigned base = 0;
+            auto faces = triangles.reserve_back(base_count);
+            auto add_face = [&](SphericalCoord v0, SphericalCoord v1, SphericalCoord v2)
+                {
+                    if (base - first_base < base_count)
+                    {
+                        faces[base - first_base] = vertices.add_triangle(v0, v1, v2);
+                    }
+                    ++base;
+                };
+
+            const float n_lat = atan(0.5f);
+            const float s_lat = -n_lat;
+            const float wedge = pi * 0.4f;  // 72 degrees
+            float       east = wedge * 0.5f;
+
+            for (int i = 0; i < 5; ++i, east += wedge)
+            {
+                auto east2 = east + wedge * 0.5f;
+                auto west = east - wedge;
+                auto mid = east2 - wedge;
+                // clockwise vertex order
+                // clang-format off
+                add_face(
+                        { pi_2, (east + west) * 0.5f },
+                        { n_lat, east },
+                        { n_lat, west });
+                add_face(
+                        { n_lat, east },
+                        { s_lat, mid },
+                        { n_lat, west });
+                add_face(
+                        { n_lat, east },
+                        { s_lat, east2 },
+                        { s_lat, mid });
+                add_face(
+                        { s_lat, mid },
+                        { s_lat, east2 },
+                        { -pi_2, (mid + east2) * 0.5f });
+                // clang-format on
+            }
+            triangles.commit(base_count);
+            mark_subdiv();
+            metrics->progress(base_count);
+            metrics->add(eCountFacesEmitted, base_count);
+            metrics->add(eCountVertsAdded, vertices.get_indices().size());
+
+            if (verbose)
+            {
+                print(true);
+                Globe::print(get_faces(), true);
+            }
+        }
+
+        void subdivide(int count = 1)
+        {
+            subdivide_from(count, 0);
+        }
+
+    private:
+        //-- `first_parent` takes up the first new level part way, its
+        // faces and vertices up to that parent already in place.
+        void subdivide_from(int count, size_t first_parent)
+        {
+            if (subdivs.empty())
+            {
+                return;  // don't have anything to subdivide. make a globe first.
+            }
+            for (int i = (int)subdivs.size() - 1; i < count; ++i, first_parent = 0)
+            {
+                stop_if_asked(first_parent);
+                auto old_triangles = slice(triangles, subdivs.back().faces());
+                auto phase = metrics->phase("subdivide", i + 1, old_triangles.size());
+                const auto verts_before = vertices.get_indices().size();
+                if (defer_uv)
+                {
+                    uv_pending = std::min(uv_pending, verts_before);
+                }
+                auto add_midpoint = [this](const glm::vec3& mid)
+                    {
+                        return defer_uv ? vertices.add(SphericalCoord(mid, SphericalCoord::deferred_uv))
+                                        : vertices.add(mid);
+                    };
+                size_t done = 0;
+                const size_t flat_begin = subdivs.back().offset_begin;
+                //-- The level's children in one block, checked once. They
+                // are taken into the list a batch at a time, before anything
+                // that reads its size: a checkpoint, or cancelling.
+                const size_t nsplit = refine_only.empty()
+                    ? old_triangles.size() - first_parent
+                    : (size_t)std::count_if(refine_only.begin() + flat_begin + first_parent,
+                                            refine_only.begin() + flat_begin + old_triangles.size(),
+                                            [](char split) { return split != 0; });
+                auto kids = triangles.reserve_back(4 * nsplit);
+                size_t committed = 0;
+                for (size_t p = first_parent; p < old_triangles.size(); ++p)
+                {
+                    if (!refine_only.empty() && !refine_only[flat_begin + p])
+                    {
+                        continue;
+                    }
+                    auto t = old_triangles[p];
+                    auto& v0 = vertices[t[0]];
+                    auto& v1 = vertices[t[1]];
+                    auto& v2 = vertices[t[2]];
+                    auto   v01 = (v0 + v1) / 2;
+                    auto   v12 = (v1 + v2) / 2;
+                    auto   v20 = (v2 + v0) / 2;
+
+                    // std::cout << "In: {" << v0 << v1 << v2 << "}\n";
+                    // std::cout << "Out: {" << v01 << v12 << v20 << "}\n";
+
+                    auto i01 = add_midpoint(v01);
+                    auto i12 = add_midpoint(v12);
+                    auto i20 = add_midpoint(v20);
+                    Triangle* out = &kids[4 * done];
+                    out[0] = { t[0], i01, i20 };
+                    out[1] = { i01, t[1], i12 };
+                    out[2] = { i20, i12, t[2] };
+                    out[3] = { i01, i12, i20 };
+
+                    if (0 == ++done % progress_batch)
+                    {
+                        triangles.commit(4 * done - committed);
+                        committed = 4 * done;
+                        metrics->progress(first_parent + done);
+                        stop_if_asked(first_parent + done);
+                        if (checkpoint_due())
+                        {
+                            checkpoint(first_parent + done);
+                        }
+                    }
+                }
+                triangles.commit(4 * done - committed);
+                mark_subdiv();
+                metrics->progress(first_parent + done);
+                stage_level();
+                checkpoint(0);
+
+                //-- Each parent offers 3 candidate vertices: either new, or merged.
+                const auto added = vertices.get_indices().size() - verts_before;
+                metrics->add(eCountVertsAdded, added);
+                metrics->add(eCountVertsMerged, done * 3 - added);
+                metrics->add(eCountFacesEmitted, done * 4);
+            }
+            if (verbose)
+            {
+                print(false);
+                Globe::print(get_faces(), false);
+            }
+        }
+
+    public:
+        void print(bool details = false) const
+        {
+            auto& indices = vertices.get_indices();
+            std::cout << "Vertices: [" << indices.size() << "], Faces: [" << triangles.size() << "] in "
+                << subdivs.size() << " subdivs:\n";
+            for (auto ss : subdivs)
+            {
+                auto s = ss.faces();
+                std::cout << std::setw(16) << (s.second - s.first) << " [" << s.first << ", " << s.second << "]\n";
+            }
+            if (details && indices.size() < 100)
+            {
+                for (size_t i = 0; i < indices.size(); ++i)
+                {
+                    const auto& v = indices[i];
+                    std::cout << std::setw(8) << i << ": " << v << std::endl;
+                }
+            }
+        }
+
+        // uv contains lat, lon in radians.
+        // lat is in [-pi/2, pi/2]
+        // lon is in [-pi, pi]
+        // normalize both to [0, 1]
+        static auto map_uv(const glm::vec2& v)
+        {
+            return glm::vec2(v.x / pi + 0.5f, v.y / pi2 + 0.5f);
+        }
+
+        static size_t index_of(float v, size_t max)
+        {
+            auto idx = v * max - 1;
+            return idx > 0.0f ? static_cast<size_t>(idx) : 0;
+        }
+
+        //-- A terrain elevation grid, int16_t metres in [lat][lon] order:
+        // row 0 is the South Pole, column 0 is 180 West.
+        struct TerrainGrid
+        {
+            const int16_t* data = nullptr;
+            size_t rows = 0;    // latitude samples
+            size_t cols = 0;    // longitude samples
+
+            bool operator!() const
+            {
+                return !data;
+            }
+            int16_t at(size_t lat, size_t lon) const
+            {
+                return data[lat * cols + lon];
+            }
+        };
+
+        //-- Elevation sample formats, for write_elevations().
+        enum EElevFormat
+        {
+            eElevInt16,     // offset + scale * q, see globe_elevs_ext
+            eElevFloat,
+        };
+
+        void map_elevations(const int16_t data[43200][86400])
+        {
+            map_elevations(TerrainGrid{ &data[0][0], 43200, 86400 });
+        }
+
+        void map_elevations(const TerrainGrid& grid)
+        {
+            compute_uv();
+            auto& verts = get_upd_vertices();
+            auto phase = metrics->phase("map_elevations", -1, verts.size());
+            auto first = verts.data();
+            sample_grid(grid, [first](size_t i, int16_t elev) { first[i].elev = elev; });
+        }
+
+        //-- Sample `grid` into a new int16 layer held in memory, 2 bytes a
+        // vertex, leaving the vertex records alone. Returns its index.
+        int add_elevation_layer(const TerrainGrid& grid, std::string name)
+        {
+            compute_uv();
+            const size_t nverts = vertices.get_indices().size();
+            auto phase = metrics->phase("sample_elevation_layer", -1, nverts);
+            ElevationLayer layer{ .name = std::move(name) };
+            layer.owned.resize(nverts);
+            auto q = layer.owned.data();
+            sample_grid(grid, [q](size_t i, int16_t elev) { q[i] = elev; });
+            layer.quant = mhy::range<const int16_t>(q, nverts);
+            elev_layers.push_back(std::move(layer));
+            return (int)elev_layers.size() - 1;
+        }
+
+    private:
+        //-- store(vertex, sample) for every vertex. Grid indices as map_uv()
+        // and index_of(), a block at a time.
+        template <class Store>
+        void sample_grid(const TerrainGrid& grid, Store&& store)
+        {
+            const size_t nverts = vertices.get_indices().size();
+            sample_range(grid, vertices.get_indices().data(), 0, nverts, store, true);
+            metrics->add(eCountElevsSampled, nverts);
+        }
+
+        //-- As sample_grid(), for vertices [first_vert, last_vert) of `first`.
+        // `report` advances the running phase's progress.
+        template <class Store>
+        void sample_range(const TerrainGrid& grid, const SphericalCoord* first, size_t first_vert, size_t last_vert,
+                          Store&& store, bool report) const
+        {
+            mhy::parallel_for(last_vert - first_vert, [&](size_t begin, size_t end)
+                {
+                    begin += first_vert;
+                    end += first_vert;
+                    uint32_t rows[simd::stage_block];
+                    uint32_t cols[simd::stage_block];
+                    size_t since = 0;
+                    for (size_t i = begin; i < end; i += simd::stage_block)
+                    {
+                        const size_t n = std::min(simd::stage_block, end - i);
+                        simd::grid_index_strided(&first[i].uv.x, vertex_stride, n,
+                                                 grid.rows, grid.cols, rows, cols);
+                        for (size_t k = 0; k < n; ++k)
+                        {
+                            store(i + k, grid.at(rows[k], cols[k]));
+                        }
+                        if ((since += n) >= progress_batch && report)
+                        {
+                            metrics->advance(since);
+                            since = 0;
+                        }
+                    }
+                    if (report)
+                    {
+                        metrics->advance(since);
+                    }
+                }, 1 << 16);
+        }
+
+        //-- 'shape': (rows, cols) in a .npy header dict, which is not null
+        // terminated.
+        static bool parse_npy_shape(std::string_view dict, size_t& rows, size_t& cols)
+        {
+            constexpr std::string_view key = "'shape': (";
+            size_t at = dict.find(key);
+            if (at == dict.npos)
+            {
+                return false;
+            }
+            at += key.size();
+            auto number = [&](size_t& value)
+                {
+                    while (at < dict.size() && dict[at] == ' ')
+                    {
+                        ++at;
+                    }
+                    auto res = std::from_chars(dict.data() + at, dict.data() + dict.size(), value);
+                    at = res.ptr - dict.data();
+                    return res.ec == std::errc();
+                };
+            auto expect = [&](char c)
+                {
+                    while (at < dict.size() && dict[at] == ' ')
+                    {
+                        ++at;
+                    }
+                    return at < dict.size() && dict[at++] == c;
+                };
+            return number(rows) && expect(',') && number(cols) && expect(')');
+        }
+
+    public:
+        //-- Locate the int16_t grid in a numpy .npy file, as written by
+        // np.save(). See notes.md. Only '<i2', C order, 2D is accepted.
+        static TerrainGrid parse_npy(mhy::MemoryMappedFile& terrain)
+        {
+            auto p = terrain.cast_to<const char>(0);
+            if (!p || terrain.size() < 10 || std::string_view(p, 6) != "\x93NUMPY")
+            {
+                std::cout << "Terrain data file is not a numpy .npy file.\n";
+                return {};
+            }
+            //-- v1 has a 2 byte header length, v2 and later 4 bytes.
+            size_t hlen = (uint8_t)p[8] | ((uint8_t)p[9] << 8);
+            size_t offset = 10;
+            if (p[6] >= 2)
+            {
+                hlen |= ((size_t)(uint8_t)p[10] << 16) | ((size_t)(uint8_t)p[11] << 24);
+                offset = 12;
+            }
+            if (offset + hlen > terrain.size())
+            {
+                std::cout << "Terrain data file header is truncated.\n";
+                return {};
+            }
+            std::string_view dict(p + offset, hlen);
+            offset += hlen;
+
+            size_t rows = 0, cols = 0;
+            if (dict.find("'descr': '<i2'") == dict.npos ||
+                dict.find("'fortran_order': False") == dict.npos ||
+                !parse_npy_shape(dict, rows, cols))
+            {
+                std::cout << "Terrain data file must hold a 2D, C order, int16 grid. Header: " << dict << std::endl;
+                return {};
+            }
+            const auto sgrid = rows * cols * sizeof(int16_t);
+            const auto tsize = terrain.size() - offset;
+            if (sgrid != tsize)
+            {
+                std::cout << "Terrain data file mismatch. Expect " << sgrid << " bytes, got " << tsize << std::endl;
+                return {};
+            }
+            return { terrain.cast_to<const int16_t>(offset), rows, cols };
+        }
+
+        bool load_from_terrain(const char* dat_name)
+        {
+            return with_terrain(dat_name, [this](const TerrainGrid& grid) { map_elevations(grid); });
+        }
+
+        //-- Sample a terrain .npy file into a new int16 layer, named for
+        // the file. Returns its index, or -1.
+        int add_terrain_layer(const char* dat_name)
+        {
+            int layer = -1;
+            with_terrain(dat_name, [&](const TerrainGrid& grid) { layer = add_elevation_layer(grid, dat_name); });
+            return layer;
+        }
+
+        //-- Write the current elevations, from the active layer or the vertex
+        // records, as an elevation layer file: a globe file header, and
+        // one eChunkElevs chunk by vertex id. Streamed in blocks.
+        // int16 samples are half the size of floats. Terrain grids are
+        // whole metres, so the default scale of 1 metre loses nothing.
+        bool write_elevations(const char* fname, EElevFormat format = eElevInt16, float scale = 1.0f)
+        {
+            auto phase = metrics->phase("write_elevations");
+            const bool quantize = format == eElevInt16;
+            if (quantize && !(scale > 0.0f))
+            {
+                std::cout << "write_elevations(): int16 scale must be positive, not " << scale << std::endl;
+                return false;
+            }
+            std::ofstream ofs(fname, std::ios::binary | std::ios::out | std::ios::trunc);
+            if (!ofs.is_open())
+            {
+                std::cout << "Error writing terrain elevations file: " << fname << std::endl;
+                return false;
+            }
+            const size_t nverts = vertices.get_indices().size();
+            const uint32_t stride = quantize ? sizeof(int16_t) : sizeof(float);
+            const globe_fileheader fheader = {
+                .id_word = 0x1234,
+                .header_bytes = sizeof(globe_fileheader),
+                .version_id = 0x0100,
+            };
+            const globe_chunk_header chunk = {
+                .chunk_type = eChunkElevs,
+                .header_bytes = chunk_align - sizeof(globe_fileheader),
+                .data_stride = stride,
+                .data_count = nverts,
+                .data_size = nverts * stride,
+            };
+            const globe_elevs_ext ext = { .scale = quantize ? scale : 1.0f };
+            static const char padding[chunk_align] = {};
+            ofs.write(reinterpret_cast<const char*>(&fheader), sizeof(fheader));
+            ofs.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+            ofs.write(reinterpret_cast<const char*>(&ext), sizeof(ext));
+            ofs.write(padding, chunk.header_bytes - sizeof(chunk) - sizeof(ext));
+
+            //-- An int16 layer at the same scale is written as it is.
+            auto layer = get_elevation_layer();
+            const bool as_is = quantize && layer && layer->is_quantized() && layer->scale == scale && layer->offset == 0;
+            float   block[4096];
+            int16_t qblock[std::size(block)];
+            for (size_t first = 0; first < nverts; first += std::size(block))
+            {
+                const size_t n = std::min(std::size(block), nverts - first);
+                if (as_is)
+                {
+                    ofs.write(reinterpret_cast<const char*>(layer->quant.begin() + first), n * sizeof(int16_t));
+                    continue;
+                }
+                read_elevations(first, n, block);
+                if (quantize)
+                {
+                    simd::narrow_i16(block, scale, 0.0f, qblock, n);
+                    ofs.write(reinterpret_cast<const char*>(qblock), n * sizeof(int16_t));
+                }
+                else
+                {
+                    ofs.write(reinterpret_cast<const char*>(block), n * sizeof(float));
+                }
+            }
+            const globe_chunk_header eof = { .chunk_type = eChunkEOF, .header_bytes = sizeof(globe_chunk_header) };
+            ofs.write(reinterpret_cast<const char*>(&eof), sizeof(eof));
+
+            ofs.close();
+            if (!ofs)
+            {
+                std::cout << "Error writing terrain elevations file: " << fname << std::endl;
+                return false;
+            }
+            metrics->add(eCountBytesWritten, chunk_align + chunk.data_size + sizeof(eof));
+            info() << "Wrote " << nverts << (quantize ? " int16" : " float") << " elevs to: " << fname << std::endl;
+            return true;
+        }
+
+        //-- Map an elevation layer file and make it the active layer.
+        // Nothing is copied; see add_elevation_layer().
+        bool load_elevations(const char* fname)
+        {
+            return use_elevation_layer(add_elevation_layer(fname));
+        }
+
+        //-- Map an elevation layer, int16 or float from write_elevations(),
+        // or a file of bare floats as it used to write. Returns its index,
+        // or -1. The layer is a read-only view, indexed by vertex id.
+        int add_elevation_layer(const char* fname)
+        {
+            auto file = std::make_unique<mhy::MemoryMappedFile>(fname);
+            if (!*file)
+            {
+                std::cout << "Error reading terrain elevations file: " << fname << std::endl;
+                return -1;
+            }
+            //-- sanity check: file and globe-mesh must
+            // agree on elev data count.
+            const size_t nverts = vertices.get_indices().size();
+            ElevationLayer layer{ .name = fname };
+            parse_elevation_layer(*file, nverts, layer);
+            if (layer.size() != nverts)
+            {
+                std::cout << "add_elevation_layer(): '" << fname << "' has " << layer.size()
+                    << " elevations. GlobeMesh expecting " << nverts << ".\n";
+                return -1;
+            }
+            metrics->add(eCountBytesMapped, file->size());
+            layer.file = std::move(file);
+            elev_layers.push_back(std::move(layer));
+            return (int)elev_layers.size() - 1;
+        }
+
+        //-- Switch elevations to `layer`, or with -1, back to the vertex records.
+        bool use_elevation_layer(int layer)
+        {
+            if (layer < -1 || layer >= (int)elev_layers.size())
+            {
+                return false;
+            }
+            active_elevs = layer;
+            return true;
+        }
+
+        int find_elevation_layer(std::string_view name) const
+        {
+            for (size_t i = 0; i < elev_layers.size(); ++i)
+            {
+                if (elev_layers[i].name == name)
+                {
+                    return (int)i;
+                }
+            }
+            return -1;
+        }
+
+        size_t elevation_layer_count() const
+        {
+            return elev_layers.size();
+        }
+
+        //-- The active layer, or null when elevations are in the vertex records.
+        const ElevationLayer* get_elevation_layer() const
+        {
+            return active_elevs < 0 ? nullptr : &elev_layers[active_elevs];
+        }
+
+        float elevation(index_type vertex) const
+        {
+            return active_elevs < 0 ? vertices[vertex].elev : elev_layers[active_elevs][vertex];
+        }
+
+        //-- Elevations of vertices [first, first + n), as floats.
+        void read_elevations(size_t first, size_t n, float* out) const
+        {
+            if (active_elevs >= 0)
+            {
+                elev_layers[active_elevs].read(first, n, out);
+                return;
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = vertices[(index_type)(first + i)].elev;
+            }
+        }
+
+    private:
+        //-- Open and parse a terrain .npy file, then fn(grid) while it is mapped.
+        template <class Fn>
+        bool with_terrain(const char* dat_name, Fn&& fn)
+        {
+            mhy::MemoryMappedFile terrain(dat_name);
+            if (!terrain)
+            {
+                std::cout << "Error opening terrain data file: " << dat_name << '\n';
+                return false;
+            }
+            auto grid = parse_npy(terrain);
+            if (!grid)
+            {
+                return false;
+            }
+            metrics->add(eCountBytesMapped, terrain.size());
+            fn(grid);
+            return true;
+        }
+
+        //-- Point `layer` at the samples in `file`. Leaves it empty if the
+        // file is neither an elevation layer nor nverts bare floats.
+        static void parse_elevation_layer(mhy::MemoryMappedFile& file, size_t nverts, ElevationLayer& layer)
+        {
+            auto fheader = file.cast_to<const globe_fileheader>(0);
+            if (file.size() >= chunk_align && fheader->id_word == 0x1234 && fheader->version_id <= 0x100)
+            {
+                const size_t i_offset = fheader->header_bytes + fheader->data_bytes;
+                auto chunk = file.cast_to<const globe_chunk_header>(i_offset);
+                if (i_offset + sizeof(globe_chunk_header) > file.size() || chunk->chunk_type != eChunkElevs ||
+                    i_offset + chunk->header_bytes + chunk->data_size > file.size())
+                {
+                    return;
+                }
+                const size_t data_offset = i_offset + chunk->header_bytes;
+                if (chunk->data_stride == sizeof(float))
+                {
+                    layer.elevs = mhy::range(file.cast_to<const float>(data_offset), chunk->data_count);
+                }
+                else if (chunk->data_stride == sizeof(int16_t))
+                {
+                    if (chunk->header_bytes >= sizeof(globe_chunk_header) + sizeof(globe_elevs_ext))
+                    {
+                        auto ext = file.cast_to<const globe_elevs_ext>(i_offset + sizeof(globe_chunk_header));
+                        layer.scale = ext->scale;
+                        layer.offset = ext->offset;
+                    }
+                    layer.quant = mhy::range(file.cast_to<const int16_t>(data_offset), chunk->data_count);
+                }
+                return;
+            }
+            if (file.size() == nverts * sizeof(float))
+            {
+                layer.elevs = mhy::range(file.cast_to<const float>(0), nverts);
+            }
+        }
+
+    public:
+        glm::vec3 elev_to_rgb(float elev)
+        {
+            using glm::vec3;
+            using HSV = vec3;
+            auto lerp_rgb = [](float val, const HSV& a, const HSV b, float v1, float v2) -> HSV
+                {
+                    float t = (val - v1) / (v2 - v1);
+                    float h = std::lerp(a.r, b.r, t);
+                    float s = std::lerp(a.g, b.g, t);
+                    float v = std::lerp(a.b, b.b, t);
+
+                    // hsv to rgb
+                    if (s == 0.0)
+                    {
+                        const HSV gray{ 0.0f, 0.0f, v };
+                        return gray;
+                    }
+
+                    {  // scope name conflicts
+                        h = fmod(h, 360.0f);
+                        h /= 60.0f;
+                        int   i = (int)floor(h);
+                        float f = h - i;
+                        float p = v * (1 - s);
+                        float q = v * (1 - f * s);
+                        float t = v * (1 - (1 - f) * s);
+
+                        switch (i)
+                        {
+                        case 0: return HSV(v, t, p);  // r = v; g = t; b = p; break;
+                        case 1: return { q, v, p };     // r = q; g = v; b = p; break;
+                        case 2: return { p, v, t };     // r = p; g = v; b = t; break;
+                        case 3: return { p, q, v };     // r = p; g = q; b = v; break;
+                        case 4: return { t, p, v };     // r = t; g = p; b = v; break;
+                        default: return { v, p, q };     // r = v; g = p; b = q; break;
+                        }
+                    }
+                };
+            // terrain elevation selects a vertex color as follows:
+            //  0..500m     : hsv(117, 92%, 36%) : hsv(88, 28%, 56%) :
+            // 500..1200m   :    ... hsv(182, 49%, 94%)
+            //   > 1200m    :   hsv(0, 0, 99)
+            // deep rich green: hsv(117, 92%, 36%)
+            // high altitude faded green: hsv(88, 28%, 56%)
+            // h > 500m :  hsv(182, 49%, 94%)
+            //  .. 1200m: hsv(206, 13%, 95%)
+            const vec3 low_land{ 117.0f, 0.92f, 0.36f };
+            const vec3 plains{ 88.0f, 0.28f, 0.56f };
+            const vec3 glacier{ 182.0f, 0.49f, 0.94f };
+            const vec3 above{ 0.90f, 0.90f, 0.95f };  // in RGB. We return this directly.
+            // 0..2000m : hsv(258, 6%, 94%) .. hsv(232, 77%, 48%)
+            //  deeper  :     hsv(240, 66%, 17%)
+            // beach  0m   : hsv(258, 6%, 94%)
+            // deep ocean .. 2000m: hsv(232, 77%, 48%)
+            const vec3 beach{ 258.0f, 0.06f, 0.72f };
+            const vec3 deep(232.0f, 0.77f, 0.22f);
+            const vec3 too_deep{ 240.0f, 0.66f, 0.17f };
+            // ocean:
+            const float sealevel = -0;
+            if (elev < sealevel)
+            {
+                return lerp_rgb(elev, beach, deep, sealevel, -7000);
+            }
+            // land:
+            if (elev < 2000)
+            {
+                return lerp_rgb(elev, low_land, plains, sealevel, 2000);
+            }
+            if (elev < 5000)
+            {
+                return lerp_rgb(elev, plains, glacier, 2000, 5000);
+            }
+            return above;
+        }
+
+    public:
+        struct globe_fileheader
+        {
+            uint16_t id_word = 0x1234;
+            uint16_t header_bytes = 16;
+            uint32_t version_id = 0x0100;
+            uint32_t data_bytes = 0;
+            uint32_t flags = 0;         // EFileFlags
+        };
+
+        enum EFileFlags : uint32_t
+        {
+            //-- generate() or extend() is still building the file. Its chunk
+            // counts are those of its last checkpoint, from which it resumes.
+            eFileBuilding = 1,
+            //-- The build defers lat/lon: those it made are redone on resume.
+            eFileUvDeferred = 2,
+        };
+
+        struct globe_chunk_header
+        {
+            uint16_t chunk_type = 0;
+            uint16_t header_bytes = 16;
+            uint32_t data_stride = 0;
+            uint64_t data_count = 0;
+            uint64_t data_size = 0;
+        };
+
+        enum EChunkType : uint16_t
+        {
+            eChunkInvalid = 0,
+            eChunkSubdivInfo,
+            eChunkFaces,
+            eChunkVerts,
+            eChunkElevs,
+            //-- Per level chunks, with a globe_level_chunk_header.
+            eChunkFaceAdjacency,
+            eChunkRingOffsets,
+            eChunkRingFaces,
+            eChunkEdges,
+            eChunkNormals,
+            eChunkPositions,
+            eChunkFaceBounds,
+            eChunkCellIds,      // regional meshes: uint64 CellId by flat face index
+            eChunkVertexKeys,   // regional meshes: uint64 name of each vertex. See globe_region.h.
+            eChunkPatchOffsets, // uint32 per patch, and one more. See globe_patches.h.
+            eChunkPatchVerts,   // uint32 global vertex ids, patch after patch
+            eChunkPatchFaces,   // uint16 x3, local to their patch
+            eChunkGridOffsets,  // uint32 per vertex bucket, and one more. See globe_nearest.h.
+            eChunkGridVerts,    // uint32 vertex ids, bucket after bucket
+            eChunkGridCones,    // VertexCone per bucket
+            //-----
+            eChunkEOF = 0xffff
+        };
+
+        static bool is_level_chunk(uint16_t chunk_type)
+        {
+            return chunk_type >= eChunkFaceAdjacency && chunk_type != eChunkEOF;
+        }
+
+        //-- Per level chunks extend the chunk header with their level.
+        // header_bytes also covers padding, up to a chunk_align boundary,
+        // so the data can be used in place from a mapped file.
+        struct globe_level_chunk_header
+        {
+            globe_chunk_header chunk;
+            uint32_t level = 0;
+            uint32_t reserved = 0;
+        };
+        static constexpr size_t chunk_align = 64;
+
+        //-- eChunkElevs: follows its globe_chunk_header. int16 samples are
+        // offset + scale * q; float samples ignore it.
+        struct globe_elevs_ext
+        {
+            float scale = 1.0f;
+            float offset = 0.0f;
+        };
+
+        //-- eChunkFaceBounds: follows its globe_level_chunk_header, whose
+        // level is the leaf level.
+        struct globe_face_bounds_ext
+        {
+            float    leaf_sag = 1;
+            uint32_t reserved = 0;
+        };
+
+        //-- eChunkPatchOffsets: follows its globe_level_chunk_header.
+        struct globe_patches_ext
+        {
+            uint32_t depth = 0;
+            uint32_t reserved = 0;
+        };
+
+        //-- eChunkGridOffsets: follows its globe_level_chunk_header.
+        struct globe_vertex_grid_ext
+        {
+            int32_t  bucket_level = 0;
+            uint32_t reserved = 0;
+        };
+
+        //-- eChunkPositions and eChunkNormals: follows its
+        // globe_level_chunk_header. Normals written before it read as a
+        // zero radius, matching no real displacement.
+        struct globe_displacement_ext
+        {
+            double   radius = 0;
+            float    exaggeration = 0;
+            uint32_t reserved = 0;
+        };
+
+    private:
+        auto write_file_header(mhy::MappedBuffer& mbuf)
+        {
+            static const globe_fileheader header = {
+                .id_word = 0x1234,
+                .header_bytes = sizeof(globe_fileheader),
+                .version_id = 0x0100,
+            };
+            auto phdr = mbuf.cast_to<globe_fileheader>(0);
+            *phdr = header;
+            return mhy::RangeT<globe_fileheader>(phdr, 1);
+        }
+
+        std::ostream& print(std::ostream& os, const globe_chunk_header& chunk)
+        {
+            os << "Chunk Header: \n"
+                "    chunk_type   = " << chunk.chunk_type << "\n"
+                "    header_bytes = " << chunk.header_bytes << "\n"
+                "    data_stride  = " << chunk.data_stride << "\n"
+                "    data_count   = " << chunk.data_count << "\n"
+                "    data_size    = " << chunk.data_size << "\n"
+                ;
+            return os;
+        }
+
+        template <class T, class U>
+        auto next_chunk(mhy::RangeT<U>& prev_chunk, size_t n = 1)
+        {
+            return mhy::RangeT<T>(reinterpret_cast<T*>(prev_chunk.end()), n);
+        }
+
+        template <class T, class U>
+        auto allocate_data_chunk(mhy::RangeT<U> prev_chunk, EChunkType etype, size_t count)
+        {
+            auto hdr = next_chunk<globe_chunk_header>(prev_chunk);
+            *hdr = { .chunk_type = etype,
+                         .header_bytes = sizeof(globe_chunk_header),
+                         .data_stride = sizeof(T),
+                         .data_count = (uint32_t)count,
+                         .data_size = sizeof(T) * count };
+            return next_chunk<T>(hdr, count);
+        }
+
+        template <class U>
+        auto write_eof_chunk(mhy::RangeT<U> prev_chunk)
+        {
+            return allocate_data_chunk<char>(prev_chunk, eChunkEOF, 0);
+        }
+
+        //-- Offset of the EOF chunk in a globe file, or 0 if there is none.
+        static size_t find_eof_chunk(std::istream& is)
+        {
+            globe_fileheader fheader;
+            if (!is.seekg(0).read(reinterpret_cast<char*>(&fheader), sizeof(fheader)) || fheader.id_word != 0x1234)
+            {
+                return 0;
+            }
+            size_t i_offset = fheader.header_bytes + fheader.data_bytes;
+            globe_chunk_header chunk;
+            while (is.seekg(i_offset).read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+            {
+                if (chunk.chunk_type == eChunkEOF)
+                {
+                    return i_offset;
+                }
+                if (chunk.header_bytes < sizeof(chunk))
+                {
+                    break;
+                }
+                i_offset += chunk.header_bytes + chunk.data_size;
+            }
+            return 0;
+        }
+
+        //-- Writes level chunks over the EOF chunk of an existing globe file,
+        // then, from finish(), a new EOF chunk. Chunk data may be written
+        // whole or streamed in pieces, and is aligned to chunk_align.
+        class ChunkAppender
+        {
+        private:
+            std::fstream fs;
+            const char*  fname;
+            size_t       eof_offset = 0;
+            size_t       i_offset = 0;     // end of what has been written
+            size_t       data_end = 0;     // end of the current chunk's data
+
+        public:
+            explicit ChunkAppender(const char* fname)
+                : fs(fname, std::ios::in | std::ios::out | std::ios::binary), fname(fname)
+            {
+                eof_offset = fs ? find_eof_chunk(fs) : 0;
+                if (!eof_offset)
+                {
+                    std::cout << "Globe file '" << fname << "' is missing or has no EOF chunk.\n";
+                    return;
+                }
+                fs.clear();
+                fs.seekp(eof_offset);
+                i_offset = data_end = eof_offset;
+            }
+
+            bool operator!() const
+            {
+                return !eof_offset || !fs;
+            }
+
+            size_t bytes_written() const
+            {
+                return i_offset - eof_offset;
+            }
+
+            //-- `ext` extends the header, for chunk types that need more than the level.
+            void begin_chunk(EChunkType chunk_type, int level, uint32_t data_stride, uint64_t data_count,
+                             const void* ext = nullptr, size_t ext_bytes = 0)
+            {
+                static const char padding[chunk_align] = {};
+                const size_t header_end = i_offset + sizeof(globe_level_chunk_header) + ext_bytes;
+                const size_t data_offset = (header_end + chunk_align - 1) / chunk_align * chunk_align;
+                const globe_level_chunk_header hdr = {
+                    .chunk = { .chunk_type = chunk_type,
+                               .header_bytes = (uint16_t)(data_offset - i_offset),
+                               .data_stride = data_stride,
+                               .data_count = data_count,
+                               .data_size = data_stride * data_count },
+                    .level = (uint32_t)level,
+                };
+                fs.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+                fs.write(static_cast<const char*>(ext), ext_bytes);
+                fs.write(padding, data_offset - header_end);
+                i_offset = data_offset;
+                data_end = data_offset + hdr.chunk.data_size;
+            }
+
+            void write(const void* data, size_t bytes)
+            {
+                fs.write(static_cast<const char*>(data), bytes);
+                i_offset += bytes;
+            }
+
+            bool finish()
+            {
+                if (i_offset != data_end)
+                {
+                    std::cout << "Globe file '" << fname << "': chunk data is "
+                        << (i_offset < data_end ? data_end - i_offset : i_offset - data_end)
+                        << (i_offset < data_end ? " bytes short of" : " bytes past")
+                        << " its header's size. Not writing the EOF chunk.\n";
+                    return false;
+                }
+                const globe_chunk_header eof = { .chunk_type = eChunkEOF, .header_bytes = sizeof(globe_chunk_header) };
+                write(&eof, sizeof(eof));
+                if (!fs.flush())
+                {
+                    std::cout << "Error appending to globe file '" << fname << "'.\n";
+                    return false;
+                }
+                return true;
+            }
+        };
+
+        //-- One whole chunk, for append_level_chunks().
+        struct LevelChunk
+        {
+            EChunkType  chunk_type;
+            int         level;
+            uint32_t    data_stride;
+            uint64_t    data_count;
+            const void* data;
+        };
+
+        bool append_level_chunks(const char* fname, std::initializer_list<LevelChunk> chunks) const
+        {
+            ChunkAppender out(fname);
+            if (!out)
+            {
+                return false;
+            }
+            for (auto& c : chunks)
+            {
+                out.begin_chunk(c.chunk_type, c.level, c.data_stride, c.data_count);
+                out.write(c.data, c.data_stride * c.data_count);
+            }
+            const bool ok = out.finish();
+            metrics->add(eCountBytesWritten, out.bytes_written());
+            return ok;
+        }
+
+        //-- Vertices streamed per block by write_normals() and write_positions().
+        static constexpr size_t normals_block = 1 << 20;
+
+        template <class Id>
+        bool bake_normals_of(int level, const Displacement& disp, size_t count, Id&& id, OctNormal* out) const
+        {
+            auto& conn = get_connectivity(level);
+            if (!conn)
+            {
+                return false;
+            }
+            auto faces = get_faces(level);
+            auto& verts = vertices.get_indices();
+            mhy::parallel_for(count, [&](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const uint32_t v = id(i);
+                        out[i] = oct_encode(normals::vertex_normal(verts, faces, conn.one_ring(v), v, disp,
+                                                                   [this](uint32_t j) { return elevation(j); }));
+                    }
+                }, 1 << 14);
+            return true;
+        }
+
+        //-- [first, last) are vertices of `level`, which becomes the finest
+        // when it is -1.
+        bool bake_range_ok(const char* what, int& level, size_t first, size_t last) const
+        {
+            if (subdivs.empty())
+            {
+                std::cout << what << ": there is no mesh.\n";
+                return false;
+            }
+            level = level_or_finest(level);
+            if (first > last || last > subdivs[level].vertex_end)
+            {
+                std::cout << what << ": vertices [" << first << ", " << last << ") are not all of level " << level << ".\n";
+                return false;
+            }
+            return true;
+        }
+
+    public:
+        //-- Normals of the displaced surface, for `level`'s vertices [first,
+        // last). False, leaving `out` be, if they are not all of the level
+        // or it has no connectivity.
+        bool bake_normals(int level, const Displacement& disp, size_t first, size_t last, OctNormal* out) const
+        {
+            return bake_range_ok("bake_normals", level, first, last) &&
+                   bake_normals_of(level, disp, last - first, [first](size_t i) { return (uint32_t)(first + i); }, out);
+        }
+
+        //-- As above, for vertices ids[0, count).
+        bool bake_normals(int level, const Displacement& disp, const uint32_t* ids, size_t count, OctNormal* out) const
+        {
+            if (!bake_range_ok("bake_normals", level, 0, 0))
+            {
+                return false;
+            }
+            const uint32_t vertex_end = (uint32_t)subdivs[level].vertex_end;
+            if (std::any_of(ids, ids + count, [vertex_end](uint32_t v) { return v >= vertex_end; }))
+            {
+                std::cout << "bake_normals: a vertex id is not of level " << level << ".\n";
+                return false;
+            }
+            return bake_normals_of(level, disp, count, [ids](size_t i) { return ids[i]; }, out);
+        }
+
+        //-- Bake `level`'s normals (default, the finest) into the globe file
+        // in one pass, a block of vertices at a time.
+        bool write_normals(const char* fname, int level = -1, const Displacement& disp = {}) const
+        {
+            auto& conn = get_connectivity(level);
+            if (!conn)
+            {
+                return false;
+            }
+            level = conn.level;
+            const size_t nverts = subdivs[level].vertex_end;
+            auto phase = metrics->phase("write_normals", level, nverts);
+            ChunkAppender out(fname);
+            if (!out)
+            {
+                return false;
+            }
+            const globe_displacement_ext ext = { .radius = disp.radius, .exaggeration = disp.exaggeration };
+            out.begin_chunk(eChunkNormals, level, sizeof(OctNormal), nverts, &ext, sizeof(ext));
+            std::vector<OctNormal> block(std::min(nverts, normals_block));
+            for (size_t first = 0; first < nverts; first += block.size())
+            {
+                const size_t n = std::min(block.size(), nverts - first);
+                if (!bake_normals(level, disp, first, first + n, block.data()))
+                {
+                    return false;
+                }
+                out.write(block.data(), n * sizeof(OctNormal));
+                metrics->progress(first + n);
+            }
+            const bool ok = out.finish();
+            metrics->add(eCountBytesWritten, out.bytes_written());
+            return ok;
+        }
+
+        //-- Displaced positions, pos * (radius + exaggeration * elev) in the
+        // units of radius and elev, for `level`'s vertices [first, last).
+        // False, leaving `out` be, if they are not all of the level.
+        bool bake_positions(int level, const Displacement& disp, size_t first, size_t last, glm::vec3* out) const
+        {
+            if (!bake_range_ok("bake_positions", level, first, last))
+            {
+                return false;
+            }
+            auto verts = &vertices.get_indices()[0];
+            auto layer = get_elevation_layer();
+            mhy::parallel_for(last - first, [&](size_t begin, size_t end)
+                {
+                    float widened[simd::stage_block];
+                    for (size_t i = begin; i < end; i += simd::stage_block)
+                    {
+                        const size_t n = std::min(simd::stage_block, end - i);
+                        auto v = verts + first + i;
+                        const float* elev = &v->elev;
+                        size_t elev_stride = vertex_stride;
+                        if (layer)
+                        {   // int16 layers widen here, where they are used.
+                            layer->read(first + i, n, widened);
+                            elev = widened;
+                            elev_stride = 1;
+                        }
+                        simd::displace_strided(&v->pos.x, vertex_stride, elev, elev_stride,
+                                               (float)disp.radius, disp.exaggeration, &out[i].x, 3, n);
+                    }
+                }, 1 << 16);
+            return true;
+        }
+
+        //-- Bake `level`'s displaced positions (default, the finest) into
+        // the globe file as packed float3, ready to map as a vertex buffer.
+        bool write_positions(const char* fname, int level = -1, const Displacement& disp = {}) const
+        {
+            if (subdivs.empty())
+            {
+                return false;
+            }
+            level = level_or_finest(level);
+            const size_t nverts = subdivs[level].vertex_end;
+            auto phase = metrics->phase("write_positions", level, nverts);
+            ChunkAppender out(fname);
+            if (!out)
+            {
+                return false;
+            }
+            const globe_displacement_ext ext = { .radius = disp.radius, .exaggeration = disp.exaggeration };
+            out.begin_chunk(eChunkPositions, level, sizeof(glm::vec3), nverts, &ext, sizeof(ext));
+            std::vector<glm::vec3> block(std::min(nverts, normals_block));
+            for (size_t first = 0; first < nverts; first += block.size())
+            {
+                const size_t n = std::min(block.size(), nverts - first);
+                if (!bake_positions(level, disp, first, first + n, block.data()))
+                {
+                    return false;
+                }
+                out.write(block.data(), n * sizeof(glm::vec3));
+                metrics->progress(first + n);
+            }
+            const bool ok = out.finish();
+            metrics->add(eCountBytesWritten, out.bytes_written());
+            return ok;
+        }
+
+        //-- `level`'s positions chunk in the loaded file, or empty, and the
+        // displacement it was baked with.
+        mhy::RangeT<const glm::vec3> get_positions(int level = -1, Displacement* disp = nullptr) const
+        {
+            auto entry = find_chunk(eChunkPositions, level_or_finest(level));
+            if (!entry || entry->data_stride != sizeof(glm::vec3) ||
+                entry->data_offset - entry->header_offset < sizeof(globe_level_chunk_header) + sizeof(globe_displacement_ext))
+            {
+                return {};
+            }
+            if (disp)
+            {
+                auto ext = load_file->cast_to<const globe_displacement_ext>(entry->header_offset + sizeof(globe_level_chunk_header));
+                *disp = { .radius = ext->radius, .exaggeration = ext->exaggeration };
+            }
+            return mhy::range(load_file->cast_to<const glm::vec3>(entry->data_offset), entry->data_count);
+        }
+
+        //-- `level`'s normals chunk in the loaded file, or empty, and the
+        // displacement it was baked with.
+        mhy::RangeT<const OctNormal> get_normals(int level = -1, Displacement* disp = nullptr) const
+        {
+            auto entry = find_chunk(eChunkNormals, level_or_finest(level));
+            if (!entry || entry->data_stride != sizeof(OctNormal) ||
+                entry->data_offset - entry->header_offset < sizeof(globe_level_chunk_header) + sizeof(globe_displacement_ext))
+            {
+                return {};
+            }
+            if (disp)
+            {
+                auto ext = load_file->cast_to<const globe_displacement_ext>(entry->header_offset + sizeof(globe_level_chunk_header));
+                *disp = { .radius = ext->radius, .exaggeration = ext->exaggeration };
+            }
+            return mhy::range(load_file->cast_to<const OctNormal>(entry->data_offset), entry->data_count);
+        }
+
+        //-- Write `level` (default, the finest) as glTF: GLB, or given a
+        // ".gltf" name, its JSON with the buffer in a .bin beside it. With
+        // `region`, ranges of faces of `level` or coarser, as from
+        // cull_faces(), only those faces and the vertices they use.
+        // The buffer streams out a block at a time. A whole level's indices,
+        // and positions or normals the file already has for it, baked with
+        // opts.disp, go straight from the mapped file; the rest is baked
+        // per block.
+        // Texture coordinates are per vertex, so wrap across the antimeridian.
+        // GLB is limited to 4 GB, about a level 11 globe; past that, write .gltf.
+        bool write_gltf(const char* fname, int level = -1, const GlbOptions& opts = {},
+                        const std::vector<DrawRange>* region = nullptr)
+        {
+            if (subdivs.empty())
+            {
+                return false;
+            }
+            level = level_or_finest(level);
+            const auto& sub = subdivs[level];
+            const Triangle* tris = triangles.data();
+            size_t nfaces = sub.offset_end - sub.offset_begin;
+            std::vector<uint32_t> region_verts;
+            if (region)
+            {
+                nfaces = 0;
+                for (auto& r : *region)
+                {
+                    if (r.first + (size_t)r.count > sub.offset_end)
+                    {
+                        std::cout << "glTF region for '" << fname << "' reaches past level " << level << "'s faces.\n";
+                        return false;
+                    }
+                    nfaces += r.count;
+                    for (size_t f = r.first; f < r.first + (size_t)r.count; ++f)
+                    {
+                        region_verts.insert(region_verts.end(), { tris[f].x, tris[f].y, tris[f].z });
+                    }
+                }
+                std::sort(region_verts.begin(), region_verts.end());
+                region_verts.erase(std::unique(region_verts.begin(), region_verts.end()), region_verts.end());
+            }
+            const size_t nverts = region ? region_verts.size() : sub.vertex_end;
+            if (!nfaces)
+            {
+                std::cout << "No faces to write to '" << fname << "'.\n";
+                return false;
+            }
+            if (opts.texcoords)
+            {
+                compute_uv();
+            }
+
+            using gltf::View;
+            const bool short_index = opts.compact && nverts < 0xffff;
+            const bool quantized = opts.compact && (opts.normals || opts.texcoords);
+            std::vector<View> views{
+                { nullptr, "SCALAR", short_index ? gltf::eUnsignedShort : gltf::eUnsignedInt, false, short_index ? 2u : 4u, 3 * nfaces },
+                { "POSITION", "VEC3", gltf::eFloat, false, sizeof(glm::vec3), nverts },
+            };
+            if (opts.normals)
+            {
+                views.push_back({ "NORMAL", "VEC3", opts.compact ? gltf::eByte : gltf::eFloat, opts.compact, opts.compact ? 4u : 12u, nverts });
+            }
+            if (opts.texcoords)
+            {
+                views.push_back({ "TEXCOORD_0", "VEC2", opts.compact ? gltf::eUnsignedShort : gltf::eFloat, opts.compact, opts.compact ? 4u : 8u, nverts });
+            }
+            const size_t buffer_bytes = gltf::lay_out(views);
+
+            const std::string_view name(fname);
+            const bool glb = !name.ends_with(".gltf");
+            std::string bin_name, uri;
+            if (!glb)
+            {
+                bin_name = std::string(name.substr(0, name.size() - 5)) + ".bin";
+                uri = bin_name.substr(bin_name.find_last_of("/\\") + 1);
+            }
+            std::string json = gltf::document(views, buffer_bytes, glb ? nullptr : uri.c_str(), {}, {}, quantized);
+            const size_t json_bytes = gltf::pad4(json.size());
+            const size_t glb_bytes = gltf::glb_overhead + json_bytes + buffer_bytes;
+            if (glb && glb_bytes > UINT32_MAX)
+            {
+                std::cout << "'" << fname << "' would be " << glb_bytes << " bytes, past GLB's 4 GB. Write .gltf instead.\n";
+                return false;
+            }
+
+            auto phase = metrics->phase("write_gltf", level, nverts);
+            std::ofstream ofs(fname, std::ios::binary | std::ios::out | std::ios::trunc);
+            std::ofstream bin_ofs;
+            if (!glb)
+            {
+                bin_ofs.open(bin_name, std::ios::binary | std::ios::out | std::ios::trunc);
+            }
+            std::ostream& bin = glb ? ofs : bin_ofs;
+            if (!ofs || !bin)
+            {
+                std::cout << "Can't create '" << (ofs ? bin_name.c_str() : fname) << "'.\n";
+                return false;
+            }
+            if (glb)
+            {
+                //-- JSON, padded with spaces, is rewritten below with its bounds.
+                const uint32_t header[5] = { gltf::glb_magic, gltf::glb_version, (uint32_t)glb_bytes,
+                                             (uint32_t)json_bytes, gltf::chunk_json };
+                const uint32_t bin_header[2] = { (uint32_t)buffer_bytes, gltf::chunk_bin };
+                json.resize(json_bytes, ' ');
+                ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+                ofs.write(json.data(), json.size());
+                ofs.write(reinterpret_cast<const char*>(bin_header), sizeof(bin_header));
+            }
+
+            size_t written = 0;
+            auto put = [&](const void* data, size_t bytes)
+                {
+                    bin.write(static_cast<const char*>(data), bytes);
+                    written += bytes;
+                };
+            auto pad = [&]()
+                {
+                    static const char zeros[4] = {};
+                    put(zeros, gltf::pad4(written) - written);
+                };
+            glm::vec3 lo(INFINITY), hi(-INFINITY);
+            auto id = [&](size_t i)
+                {
+                    return region ? region_verts[i] : (uint32_t)i;
+                };
+            const size_t block = std::min(nverts, normals_block);
+
+            //-- Indices.
+            if (!region && !short_index)
+            {
+                put(tris + sub.offset_begin, nfaces * sizeof(Triangle));
+            }
+            else
+            {
+                std::vector<uint32_t> idx;
+                std::vector<uint16_t> idx16;
+                idx.reserve(3 * std::min(nfaces, normals_block));
+                auto flush = [&]()
+                    {
+                        if (short_index)
+                        {
+                            idx16.assign(idx.begin(), idx.end());
+                            put(idx16.data(), idx16.size() * sizeof(uint16_t));
+                        }
+                        else
+                        {
+                            put(idx.data(), idx.size() * sizeof(uint32_t));
+                        }
+                        idx.clear();
+                    };
+                auto add_face = [&](size_t f)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            const uint32_t v = tris[f][k];
+                            idx.push_back(region ? (uint32_t)(std::lower_bound(region_verts.begin(), region_verts.end(), v) - region_verts.begin()) : v);
+                        }
+                        if (idx.size() == idx.capacity())
+                        {
+                            flush();
+                        }
+                    };
+                if (region)
+                {
+                    for (auto& r : *region)
+                    {
+                        for (size_t f = r.first; f < r.first + (size_t)r.count; ++f)
+                        {
+                            add_face(f);
+                        }
+                    }
+                }
+                else
+                {
+                    for (size_t f = sub.offset_begin; f < sub.offset_end; ++f)
+                    {
+                        add_face(f);
+                    }
+                }
+                flush();
+            }
+            pad();
+
+            //-- Positions.
+            Displacement file_disp;
+            auto file_positions = region ? mhy::RangeT<const glm::vec3>() : get_positions(level, &file_disp);
+            const bool from_file = file_positions.size() == nverts && file_disp.radius == opts.disp.radius &&
+                                   file_disp.exaggeration == opts.disp.exaggeration;
+            std::vector<glm::vec3> pos(from_file ? 0 : block);
+            for (size_t first = 0; first < nverts; first += block)
+            {
+                const size_t n = std::min(block, nverts - first);
+                const glm::vec3* p = pos.data();
+                if (from_file)
+                {
+                    p = file_positions.data() + first;
+                }
+                else if (region)
+                {
+                    mhy::parallel_for(n, [&](size_t begin, size_t end)
+                        {
+                            for (size_t i = begin; i < end; ++i)
+                            {
+                                pos[i] = glm::vec3(displaced(region_verts[first + i], opts.disp));
+                            }
+                        }, 1 << 16);
+                }
+                else if (!bake_positions(level, opts.disp, first, first + n, pos.data()))
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < n; ++i)
+                {
+                    lo = glm::min(lo, p[i]);
+                    hi = glm::max(hi, p[i]);
+                }
+                put(p, n * sizeof(glm::vec3));
+                metrics->progress(first + n);
+            }
+
+            //-- Normals, from the file's when it has them.
+            if (opts.normals)
+            {
+                Displacement normals_disp;
+                auto file_normals = get_normals(level, &normals_disp);
+                const bool normals_from_file = file_normals.size() == sub.vertex_end && normals_disp.radius == opts.disp.radius &&
+                                               normals_disp.exaggeration == opts.disp.exaggeration;
+                std::vector<OctNormal> oct(block);
+                std::vector<glm::vec3> normal(opts.compact ? 0 : block);
+                std::vector<std::array<int8_t, 4>> normal8(opts.compact ? block : 0);
+                for (size_t first = 0; first < nverts; first += block)
+                {
+                    const size_t n = std::min(block, nverts - first);
+                    if (normals_from_file)
+                    {
+                        for (size_t i = 0; i < n; ++i)
+                        {
+                            oct[i] = file_normals[id(first + i)];
+                        }
+                    }
+                    else if (region ? !bake_normals(level, opts.disp, region_verts.data() + first, n, oct.data())
+                                    : !bake_normals(level, opts.disp, first, first + n, oct.data()))
+                    {
+                        return false;
+                    }
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        const glm::vec3 v = oct_decode(oct[i]);
+                        if (opts.compact)
+                        {
+                            normal8[i] = { (int8_t)std::lround(v.x * 127), (int8_t)std::lround(v.y * 127), (int8_t)std::lround(v.z * 127), 0 };
+                        }
+                        else
+                        {
+                            normal[i] = v;
+                        }
+                    }
+                    put(opts.compact ? (const void*)normal8.data() : normal.data(), n * views[2].stride);
+                }
+            }
+
+            //-- Texture coordinates.
+            if (opts.texcoords)
+            {
+                auto& verts = vertices.get_indices();
+                std::vector<glm::vec2> uv(opts.compact ? 0 : block);
+                std::vector<std::array<uint16_t, 2>> uv16(opts.compact ? block : 0);
+                for (size_t first = 0; first < nverts; first += block)
+                {
+                    const size_t n = std::min(block, nverts - first);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        const glm::vec2 t = gltf::texcoord(verts[id(first + i)].uv);
+                        if (opts.compact)
+                        {
+                            uv16[i] = { (uint16_t)std::lround(std::clamp(t.x, 0.0f, 1.0f) * 65535),
+                                        (uint16_t)std::lround(std::clamp(t.y, 0.0f, 1.0f) * 65535) };
+                        }
+                        else
+                        {
+                            uv[i] = t;
+                        }
+                    }
+                    put(opts.compact ? (const void*)uv16.data() : uv.data(), n * views.back().stride);
+                }
+            }
+
+            //-- The JSON again, now with POSITION's bounds, at the same length.
+            json = gltf::document(views, buffer_bytes, glb ? nullptr : uri.c_str(), lo, hi, quantized);
+            if (glb)
+            {
+                json.resize(json_bytes, ' ');
+                ofs.seekp(12 + 8);
+            }
+            ofs.write(json.data(), json.size());
+            if (written != buffer_bytes || !ofs.flush() || !bin.flush())
+            {
+                std::cout << "Error writing glTF '" << fname << "'.\n";
+                return false;
+            }
+            metrics->add(eCountBytesWritten, glb ? glb_bytes : json.size() + buffer_bytes);
+            return true;
+        }
+
+        //-- Persist `level`'s connectivity (default, the finest) into the
+        // globe file, for load_from_mesh() to map. Builds it if needed.
+        bool write_connectivity(const char* fname, int level = -1) const
+        {
+            auto& conn = get_connectivity(level);
+            if (!conn)
+            {
+                return false;
+            }
+            auto phase = metrics->phase("write_connectivity", conn.level);
+            auto chunk = [&](EChunkType type, auto& range) -> LevelChunk
+                {
+                    return { type, conn.level, (uint32_t)sizeof(*range.begin()), range.size(), range.begin() };
+                };
+            return append_level_chunks(fname, {
+                chunk(eChunkFaceAdjacency, conn.adjacency),
+                chunk(eChunkRingOffsets, conn.ring_offsets),
+                chunk(eChunkRingFaces, conn.ring_faces),
+                chunk(eChunkEdges, conn.edges),
+            });
+        }
+
+        //-- Vertex `vertex` raised to radius + exaggeration * elevation, as
+        // bake_positions() does, in double.
+        glm::dvec3 displaced(index_type vertex, const Displacement& disp) const
+        {
+            return glm::dvec3(vertices[vertex].pos) * (disp.radius + disp.exaggeration * (double)elevation(vertex));
+        }
+
+        //-- Shell bounds for picking against `level` (default, the finest),
+        // from the active elevations. Build again after switching layers.
+        PickIndex build_pick_index(int level = -1, const Displacement& disp = {}) const
+        {
+            PickIndex index;
+            if (subdivs.empty() || !has_full_levels("build_pick_index"))
+            {
+                return index;
+            }
+            level = level_or_finest(level);
+            auto level_faces = [this](int l) { return subdivs[l].offset_end - subdivs[l].offset_begin; };
+            auto phase = metrics->phase("build_pick_index", level, level_faces(level));
+            index.disp = disp;
+            index.level_begin.resize(level + 1);
+            for (int l = 0; l < level; ++l)
+            {
+                index.level_begin[l + 1] = index.level_begin[l] + level_faces(l);
+            }
+            index.bounds.resize(index.level_begin[level]);
+
+            if (level > 0)
+            {   // the parents of the leaves, from their children's flat triangles.
+                auto leaves = get_faces(level);
+                auto out = &index.bounds[index.level_begin[level - 1]];
+                mhy::parallel_for(level_faces(level - 1), [&](size_t first, size_t last)
+                    {
+                        for (size_t p = first; p < last; ++p)
+                        {
+                            ShellBound b{ INFINITY, 0.0f };
+                            for (size_t f = 4 * p; f < 4 * p + 4; ++f)
+                            {
+                                const auto t = leaves[f];
+                                glm::dvec3 unit[3];
+                                double r[3];
+                                for (int i = 0; i < 3; ++i)
+                                {
+                                    const glm::dvec3 pos(vertices[t[i]].pos);
+                                    const double len = glm::length(pos);
+                                    unit[i] = pos / len;
+                                    r[i] = len * (disp.radius + disp.exaggeration * (double)elevation(t[i]));
+                                }
+                                const auto tb = pick::triangle_bound(unit, r);
+                                b = { std::min(b.r_min, tb.r_min), std::max(b.r_max, tb.r_max) };
+                            }
+                            out[p] = b;
+                        }
+                    }, 1 << 14);
+            }
+            for (int l = level - 2; l >= 0; --l)
+            {
+                auto out = &index.bounds[index.level_begin[l]];
+                auto in = &index.bounds[index.level_begin[l + 1]];
+                mhy::parallel_for(level_faces(l), [&](size_t first, size_t last)
+                    {
+                        for (size_t p = first; p < last; ++p)
+                        {
+                            auto c = in + 4 * p;
+                            out[p] = { std::min({ c[0].r_min, c[1].r_min, c[2].r_min, c[3].r_min }),
+                                       std::max({ c[0].r_max, c[1].r_max, c[2].r_max, c[3].r_max }) };
+                        }
+                    }, 1 << 16);
+            }
+            index.level = level;
+            metrics->progress(level_faces(level));
+            return index;
+        }
+
+        //-- The nearest hit of each ray on the displaced surface of
+        // `index.level`, or a miss. Parallel over rays.
+        void pick(const PickIndex& index, const Ray* rays, size_t count, RayHit* hits) const
+        {
+            if (!index)
+            {
+                std::fill_n(hits, count, RayHit());
+                return;
+            }
+            mhy::parallel_for(count, [&](size_t first, size_t last)
+                {
+                    std::vector<PickNode> stack;
+                    stack.reserve(4 * index.level + subdivs[0].offset_end);
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        hits[i] = pick_one(index, rays[i], stack);
+                    }
+                }, 64);
+            metrics->add(eCountRaysPicked, count);
+        }
+
+        RayHit pick(const PickIndex& index, const Ray& ray) const
+        {
+            RayHit hit;
+            pick(index, &ray, 1, &hit);
+            return hit;
+        }
+
+    private:
+        struct PickNode
+        {
+            int      level;
+            uint32_t face;
+            double   t;         // where the ray enters its bound
+        };
+
+        RayHit pick_one(const PickIndex& index, const Ray& ray, std::vector<PickNode>& stack) const
+        {
+            const int level = index.level;
+            RayHit hit;
+            hit.t = ray.t_max;
+            auto test_leaf = [&](size_t f)
+                {
+                    const auto& tri = triangles[subdivs[level].offset_begin + f];
+                    double t, u, v;
+                    if (pick::intersect_triangle(ray, displaced(tri[0], index.disp), displaced(tri[1], index.disp),
+                                                 displaced(tri[2], index.disp), hit.t, t, u, v))
+                    {
+                        hit = { (uint32_t)f, (float)u, (float)v, t };
+                    }
+                };
+            auto visit = [&](int l, size_t f)
+                {
+                    glm::dvec3 c[3];
+                    face_corners(l, f, c);
+                    const double t = pick::enter_node(ray, c, index.bound(l, f), 0.0, hit.t);
+                    if (t < hit.t)
+                    {
+                        stack.push_back({ l, (uint32_t)f, t });
+                    }
+                };
+            //-- Nearest last, to be popped first.
+            auto sort_from = [&](size_t mark)
+                {
+                    std::sort(stack.begin() + mark, stack.end(),
+                              [](const PickNode& a, const PickNode& b) { return a.t > b.t; });
+                };
+
+            const size_t nbase = subdivs[0].offset_end - subdivs[0].offset_begin;
+            if (level == 0)
+            {
+                for (size_t f = 0; f < nbase; ++f)
+                {
+                    test_leaf(f);
+                }
+            }
+            else
+            {
+                stack.clear();
+                for (size_t f = 0; f < nbase; ++f)
+                {
+                    visit(0, f);
+                }
+                sort_from(0);
+                while (!stack.empty())
+                {
+                    const auto node = stack.back();
+                    stack.pop_back();
+                    if (node.t >= hit.t)
+                    {
+                        continue;
+                    }
+                    if (node.level == level - 1)
+                    {
+                        for (size_t f = 4 * (size_t)node.face; f < 4 * (size_t)node.face + 4; ++f)
+                        {
+                            test_leaf(f);
+                        }
+                        continue;
+                    }
+                    const size_t mark = stack.size();
+                    for (size_t f = 4 * (size_t)node.face; f < 4 * (size_t)node.face + 4; ++f)
+                    {
+                        visit(node.level + 1, f);
+                    }
+                    sort_from(mark);
+                }
+            }
+            if (!hit)
+            {
+                hit.t = RayHit().t;
+            }
+            return hit;
+        }
+
+        //-- Unit corners of face `face` of level `l`.
+        void face_corners(int l, size_t face, glm::dvec3 (&c)[3]) const
+        {
+            const auto& tri = triangles[subdivs[l].offset_begin + face];
+            for (int i = 0; i < 3; ++i)
+            {
+                c[i] = glm::dvec3(vertices[tri[i]].pos);
+            }
+        }
+
+        //-- Faces sharing an edge agree exactly on its plane, so this only
+        // absorbs rounding in the weights.
+        static constexpr double locate_slack = 1e-12;
+        static constexpr int    max_walk = 64;
+
+        //-- The face of `level` nearest to holding `p`, down the hierarchy.
+        // Float midpoints tile their parent only to about 1e-7, so it may be
+        // a neighbor of the right one.
+        uint32_t descend_to(int level, const glm::dvec3& p) const
+        {
+            size_t first = 0;
+            size_t last = subdivs[0].offset_end - subdivs[0].offset_begin;
+            size_t face = 0;
+            for (int l = 0;; ++l)
+            {
+                double best = -INFINITY;
+                for (size_t f = first; f < last; ++f)
+                {
+                    glm::dvec3 c[3];
+                    face_corners(l, f, c);
+                    const double w = profile::min_weight(profile::cone_weights(p, c));
+                    if (w > best)
+                    {
+                        best = w;
+                        face = f;
+                    }
+                }
+                if (l == level)
+                {
+                    return (uint32_t)face;
+                }
+                first = 4 * face;
+                last = first + 4;
+            }
+        }
+
+        //-- From `face`, step across the edge facing `p` until a face holds
+        // it. UINT32_MAX across an open edge, off the mesh. `w` gets p's
+        // cone weights in the face found. A start too far away to reach in
+        // max_walk steps starts over from descend_to(); a face is returned
+        // only once it is found to hold `p`.
+        uint32_t walk_to(const LevelConnectivity& conn, int level, uint32_t face, const glm::dvec3& p, glm::dvec3& w) const
+        {
+            bool found = false;
+            face = walk_from(conn, level, face, p, w, found);
+            if (!found && face != UINT32_MAX)
+            {
+                face = walk_from(conn, level, descend_to(level, p), p, w, found);
+            }
+            return found ? face : UINT32_MAX;
+        }
+
+        //-- Up to max_walk steps of walk_to(). `found` once a face holds `p`.
+        uint32_t walk_from(const LevelConnectivity& conn, int level, uint32_t face, const glm::dvec3& p, glm::dvec3& w, bool& found) const
+        {
+            for (int step = 0; step < max_walk; ++step)
+            {
+                glm::dvec3 c[3];
+                face_corners(level, face, c);
+                w = profile::cone_weights(p, c);
+                const int i = w.x <= w.y && w.x <= w.z ? 0 : w.y <= w.z ? 1 : 2;
+                if (w[i] >= -locate_slack || !conn)
+                {
+                    found = true;
+                    return face;
+                }
+                //-- Corner i's weight is negative beyond the edge opposite it.
+                face = conn.adjacency[face].face[(i + 1) % 3];
+                if (face == no_face)
+                {
+                    return UINT32_MAX;
+                }
+            }
+            return face;
+        }
+
+        //-- Samples at 0, step, 2 step, ... short of `len`. The path's end is one more.
+        static size_t samples_below(double len, double step)
+        {
+            size_t k = (size_t)std::ceil(len / step);
+            while (k > 0 && (k - 1) * step >= len)
+            {
+                --k;
+            }
+            while (k * step < len)
+            {
+                ++k;
+            }
+            return k;
+        }
+
+        static double path_length(const glm::vec3* pts, size_t npts)
+        {
+            double len = 0;
+            for (size_t j = 1; j < npts; ++j)
+            {
+                len += central_angle(glm::normalize(glm::dvec3(pts[j - 1])), glm::normalize(glm::dvec3(pts[j])));
+            }
+            return len;
+        }
+
+        //-- Fill the samples of one path. Angles along each arc go through
+        // simd::sin_cos() a block at a time; in float, which places samples
+        // to within about 1e-7 of the radius.
+        void sample_path(const LevelConnectivity& conn, int level, const glm::vec3* pts, size_t npts,
+                         double step, double radius, ProfileSample* out) const
+        {
+            uint32_t face = UINT32_MAX;
+            auto emit = [&](const glm::dvec3& p, double distance)
+                {
+                    glm::dvec3 w(0.0);
+                    face = walk_to(conn, level, face == UINT32_MAX ? descend_to(level, p) : face, p, w);
+                    float elev = std::numeric_limits<float>::quiet_NaN();
+                    if (face != UINT32_MAX)
+                    {
+                        const auto& tri = triangles[subdivs[level].offset_begin + face];
+                        elev = (float)((w.x * elevation(tri[0]) + w.y * elevation(tri[1]) + w.z * elevation(tri[2]))
+                                       / (w.x + w.y + w.z));
+                    }
+                    *out++ = { distance * radius, elev, face };
+                };
+
+            float angle[simd::stage_block], s[simd::stage_block], c[simd::stage_block];
+            double len = 0;     // to the start of this arc
+            size_t k = 0;       // next sample
+            for (size_t j = 1; j < npts; ++j)
+            {
+                const glm::dvec3 a = glm::normalize(glm::dvec3(pts[j - 1]));
+                const glm::dvec3 b = glm::normalize(glm::dvec3(pts[j]));
+                const double theta = central_angle(a, b);
+                const double arc_end = len + theta;
+                if (theta > 0)
+                {
+                    const glm::dvec3 toward = glm::normalize(b - glm::dot(a, b) * a);
+                    while (k * step < arc_end)
+                    {
+                        size_t m = 0;
+                        for (; m < simd::stage_block && (k + m) * step < arc_end; ++m)
+                        {
+                            angle[m] = (float)((k + m) * step - len);
+                        }
+                        simd::sin_cos(angle, s, c, m);
+                        for (size_t i = 0; i < m; ++i)
+                        {
+                            emit((double)c[i] * a + (double)s[i] * toward, (k + i) * step);
+                        }
+                        k += m;
+                    }
+                }
+                len = arc_end;
+            }
+            if (npts)
+            {
+                emit(glm::normalize(glm::dvec3(pts[npts - 1])), len);
+            }
+        }
+
+    public:
+        //-- The face of `level` (default, the finest) whose wedge holds unit
+        // vector `p`, or UINT32_MAX off the mesh, as beyond a hexcap.
+        uint32_t locate_face(const glm::dvec3& p, int level = -1) const
+        {
+            if (subdivs.empty())
+            {
+                return UINT32_MAX;
+            }
+            level = level_or_finest(level);
+            glm::dvec3 w;
+            return walk_to(get_connectivity(level), level, descend_to(level, p), p, w);
+        }
+
+        //-- Bounds of every face of levels 0 to `level` (default, the finest),
+        // over `level`'s vertices, as loaded from the mesh file or built now
+        // from the active elevations and kept. Build again after switching
+        // elevation layers: build_face_bounds().
+        const FaceBounds& get_face_bounds(int level = -1) const
+        {
+            static const FaceBounds none;
+            if (subdivs.empty())
+            {
+                return none;
+            }
+            level = level_or_finest(level);
+            return face_bounds.get(level, [&](FaceBounds& fb)
+                {
+                    if (!fb)
+                    {
+                        fb = make_face_bounds(level);
+                    }
+                });
+        }
+
+        //-- Build them again, as after switching elevation layers. Not while
+        // other threads hold them.
+        void build_face_bounds(int level = -1)
+        {
+            if (subdivs.empty())
+            {
+                return;
+            }
+            level = level_or_finest(level);
+            face_bounds.rebuild(level, make_face_bounds(level));
+        }
+
+        //-- Leaves from their corners, then each level up from the one below.
+        // Every level is one parallel pass.
+        FaceBounds make_face_bounds(int level) const
+        {
+            FaceBounds fb;
+            if (!has_full_levels("build_face_bounds"))
+            {
+                return fb;
+            }
+            auto phase = metrics->phase("build_face_bounds", level, subdivs[level].offset_end);
+            fb.leaf_level = level;
+            fb.owned.resize(subdivs[level].offset_end);
+            FaceBound* out = fb.owned.data();
+            std::mutex sag_lock;
+            double sag = 1;
+
+            for (int l = level; l >= 0; --l)
+            {
+                const size_t begin = subdivs[l].offset_begin;
+                const size_t child_begin = l < level ? subdivs[l + 1].offset_begin : 0;
+                mhy::parallel_for(subdivs[l].offset_end - begin, [&](size_t first, size_t last)
+                    {
+                        double block_sag = 1;
+                        for (size_t f = first; f < last; ++f)
+                        {
+                            const auto& tri = triangles[begin + f];
+                            glm::dvec3 unit[3];
+                            for (int i = 0; i < 3; ++i)
+                            {
+                                unit[i] = glm::normalize(glm::dvec3(vertices[tri[i]].pos));
+                            }
+                            FaceBound b;
+                            double cos_exact;
+                            bounds::corner_cone(unit, b, cos_exact);
+                            if (l == level)
+                            {
+                                const float e[3] = { elevation(tri[0]), elevation(tri[1]), elevation(tri[2]) };
+                                b.elev_min = std::min({ e[0], e[1], e[2] });
+                                b.elev_max = std::max({ e[0], e[1], e[2] });
+                                block_sag = std::min(block_sag, cos_exact);
+                            }
+                            else
+                            {
+                                auto c = out + child_begin + 4 * f;
+                                b.elev_min = std::min({ c[0].elev_min, c[1].elev_min, c[2].elev_min, c[3].elev_min });
+                                b.elev_max = std::max({ c[0].elev_max, c[1].elev_max, c[2].elev_max, c[3].elev_max });
+                            }
+                            out[begin + f] = b;
+                        }
+                        if (l == level)
+                        {
+                            std::lock_guard<std::mutex> lock(sag_lock);
+                            sag = std::min(sag, block_sag);
+                        }
+                    }, 1 << 14);
+                metrics->progress(subdivs[level].offset_end - begin);
+            }
+            //-- round down, to float.
+            fb.leaf_sag = std::nextafter((float)sag, 0.0f);
+            fb.bounds = mhy::range<const FaceBound>(fb.owned.data(), fb.owned.size());
+            return fb;
+        }
+
+        //-- Persist the face bounds of leaf `level` (default, the finest) into
+        // the globe file, for load_from_mesh() to map. Builds them if needed.
+        bool write_face_bounds(const char* fname, int level = -1) const
+        {
+            auto& fb = get_face_bounds(level);
+            if (!fb)
+            {
+                return false;
+            }
+            auto phase = metrics->phase("write_face_bounds", fb.leaf_level, fb.bounds.size());
+            ChunkAppender out(fname);
+            if (!out)
+            {
+                return false;
+            }
+            const globe_face_bounds_ext ext = { .leaf_sag = fb.leaf_sag };
+            out.begin_chunk(eChunkFaceBounds, fb.leaf_level, sizeof(FaceBound), fb.bounds.size(), &ext, sizeof(ext));
+            out.write(fb.bounds.begin(), fb.bounds.size() * sizeof(FaceBound));
+            const bool ok = out.finish();
+            metrics->add(eCountBytesWritten, out.bytes_written());
+            return ok;
+        }
+
+        //-- `level` (default, the finest) in patches for 16 bit indices, as
+        // loaded from the mesh file, or built now at the default depth and
+        // kept. See globe_patches.h.
+        const Patches& get_patches(int level = -1) const
+        {
+            static const Patches none;
+            if (subdivs.empty())
+            {
+                return none;
+            }
+            level = level_or_finest(level);
+            return patch_levels.get(level, [&](Patches& p)
+                {
+                    if (!p || p.vertex_ids.empty() || p.count() * p.patch_faces() != p.faces.size())
+                    {
+                        p = build_patches(level);
+                    }
+                });
+        }
+
+        //-- Patches of `level` whose roots are `depth` levels up, or the base
+        // faces if fewer. Two passes over each patch's corners: one to count
+        // its vertices, one to list them, once all patches' offsets are known.
+        Patches build_patches(int level = -1, unsigned depth = patches::default_depth) const
+        {
+            Patches p;
+            if (subdivs.empty() || !has_full_levels("build_patches"))
+            {
+                return p;
+            }
+            if (depth > patches::max_depth)
+            {
+                std::cout << "build_patches(): depth " << depth << " is past " << patches::max_depth
+                    << ", whose vertices would not fit 16 bit indices.\n";
+                return p;
+            }
+            level = level_or_finest(level);
+            const unsigned root = (unsigned)std::max(0, level - (int)depth);
+            p.level = level;
+            p.depth = level - root;
+            p.face_begin = subdivs[level].offset_begin;
+            const size_t npatches = subdivs[root].offset_end - subdivs[root].offset_begin;
+            const size_t per_patch = p.patch_faces();
+            auto phase = metrics->phase("build_patches", level, npatches);
+            const Triangle* faces = triangles.data() + p.face_begin;
+
+            //-- A patch's vertices, sorted and unique, into `ids`.
+            auto collect = [faces, per_patch](size_t patch, std::vector<uint32_t>& ids)
+                {
+                    auto first = faces + patch * per_patch;
+                    ids.assign(&first[0][0], &first[0][0] + 3 * per_patch);
+                    std::sort(ids.begin(), ids.end());
+                    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+                };
+            p.owned_offsets.resize(npatches + 1);
+            mhy::parallel_for(npatches, [&](size_t begin, size_t end)
+                {
+                    std::vector<uint32_t> ids;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        collect(i, ids);
+                        p.owned_offsets[i + 1] = (uint32_t)ids.size();
+                    }
+                }, 64);
+            for (size_t i = 0; i < npatches; ++i)
+            {
+                if (p.owned_offsets[i + 1] > UINT16_MAX + 1)
+                {
+                    std::cout << "build_patches(): patch " << i << " has " << p.owned_offsets[i + 1] << " vertices, past 16 bit indices.\n";
+                    return {};
+                }
+                p.owned_offsets[i + 1] += p.owned_offsets[i];
+            }
+            p.owned_ids.resize(p.owned_offsets.back());
+            p.owned_faces.resize(npatches * per_patch);
+            mhy::parallel_for(npatches, [&](size_t begin, size_t end)
+                {
+                    std::vector<uint32_t> ids;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        collect(i, ids);
+                        std::copy(ids.begin(), ids.end(), p.owned_ids.begin() + p.owned_offsets[i]);
+                        auto local = [&ids](uint32_t v) { return (uint16_t)(std::lower_bound(ids.begin(), ids.end(), v) - ids.begin()); };
+                        for (size_t f = i * per_patch; f < (i + 1) * per_patch; ++f)
+                        {
+                            p.owned_faces[f] = { local(faces[f][0]), local(faces[f][1]), local(faces[f][2]) };
+                        }
+                    }
+                    metrics->advance(end - begin);
+                }, 64);
+            p.offsets = mhy::range<const uint32_t>(p.owned_offsets.data(), p.owned_offsets.size());
+            p.vertex_ids = mhy::range<const uint32_t>(p.owned_ids.data(), p.owned_ids.size());
+            p.faces = mhy::range<const PatchFace>(p.owned_faces.data(), p.owned_faces.size());
+            return p;
+        }
+
+        //-- Persist `level`'s patches (default, the finest) into the globe
+        // file, for load_from_mesh() to map: `depth` as build_patches().
+        bool write_patches(const char* fname, int level = -1, unsigned depth = patches::default_depth) const
+        {
+            if (subdivs.empty())
+            {
+                return false;
+            }
+            level = level_or_finest(level);
+            const Patches p = build_patches(level, depth);
+            if (!p)
+            {
+                return false;
+            }
+            auto phase = metrics->phase("write_patches", level, p.faces.size());
+            ChunkAppender out(fname);
+            if (!out)
+            {
+                return false;
+            }
+            const globe_patches_ext ext = { .depth = p.depth };
+            out.begin_chunk(eChunkPatchOffsets, level, sizeof(uint32_t), p.offsets.size(), &ext, sizeof(ext));
+            out.write(p.offsets.begin(), p.offsets.size() * sizeof(uint32_t));
+            out.begin_chunk(eChunkPatchVerts, level, sizeof(uint32_t), p.vertex_ids.size());
+            out.write(p.vertex_ids.begin(), p.vertex_ids.size() * sizeof(uint32_t));
+            out.begin_chunk(eChunkPatchFaces, level, sizeof(PatchFace), p.faces.size());
+            out.write(p.faces.begin(), p.faces.size() * sizeof(PatchFace));
+            const bool ok = out.finish();
+            metrics->add(eCountBytesWritten, out.bytes_written());
+            return ok;
+        }
+
+        //-- The nearest vertex index of `level` (default, the finest), as
+        // loaded from the mesh file, or built now and kept. See globe_nearest.h.
+        const VertexGrid& get_vertex_grid(int level = -1) const
+        {
+            static const VertexGrid none;
+            if (subdivs.empty())
+            {
+                return none;
+            }
+            level = level_or_finest(level);
+            return vertex_grids.get(level, [&](VertexGrid& g)
+                {
+                    if (!g || g.bucket_level < 0 || g.bucket_level > level ||
+                        g.offsets.size() != g.cones.size() + 1 || g.vertex_ids.size() != g.offsets[g.cones.size()])
+                    {
+                        g = build_vertex_grid(level);
+                    }
+                });
+        }
+
+        //-- Each vertex goes to the least bucket face among the faces it is a
+        // corner of; then, bucket by bucket, in ascending order.
+        VertexGrid build_vertex_grid(int level = -1) const
+        {
+            VertexGrid g;
+            if (subdivs.empty() || !has_full_levels("build_vertex_grid"))
+            {
+                return g;
+            }
+            level = level_or_finest(level);
+            g.level = level;
+            g.bucket_level = std::max(0, level - nearest::cells_below);
+            auto faces = get_faces(level);
+            const size_t nverts = subdivs[level].vertex_end;
+            const size_t nbuckets = subdivs[g.bucket_level].offset_end - subdivs[g.bucket_level].offset_begin;
+            const unsigned shift = 2 * (level - g.bucket_level);
+            auto phase = metrics->phase("build_vertex_grid", level, nbuckets);
+
+            std::vector<uint32_t> owner(nverts, UINT32_MAX);
+            mhy::parallel_for(faces.size(), [&](size_t begin, size_t end)
+                {
+                    for (size_t f = begin; f < end; ++f)
+                    {
+                        const uint32_t bucket = uint32_t(f >> shift);
+                        const Triangle t = faces[f];
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            std::atomic_ref<uint32_t> o(owner[t[k]]);
+                            uint32_t held = o.load(std::memory_order_relaxed);
+                            while (bucket < held && !o.compare_exchange_weak(held, bucket, std::memory_order_relaxed))
+                            {
+                            }
+                        }
+                    }
+                }, 1 << 16);
+
+            g.owned_offsets.assign(nbuckets + 1, 0);
+            for (auto b : owner)
+            {
+                if (b != UINT32_MAX)
+                {
+                    ++g.owned_offsets[b + 1];
+                }
+            }
+            for (size_t b = 0; b < nbuckets; ++b)
+            {
+                g.owned_offsets[b + 1] += g.owned_offsets[b];
+            }
+            g.owned_ids.resize(g.owned_offsets.back());
+            {
+                std::vector<uint32_t> next(g.owned_offsets.begin(), g.owned_offsets.end() - 1);
+                for (uint32_t v = 0; v < nverts; ++v)
+                {
+                    if (owner[v] != UINT32_MAX)
+                    {
+                        g.owned_ids[next[owner[v]]++] = v;
+                    }
+                }
+            }
+
+            //-- About the bucket face's corners, which bound the face, and
+            // wide enough for its vertices, which stray by float rounding.
+            g.owned_cones.resize(nbuckets);
+            auto& verts = vertices.get_indices();
+            mhy::parallel_for(nbuckets, [&](size_t begin, size_t end)
+                {
+                    for (size_t b = begin; b < end; ++b)
+                    {
+                        glm::dvec3 c[3];
+                        face_corners(g.bucket_level, b, c);
+                        const glm::dvec3 axis = glm::normalize(c[0] + c[1] + c[2]);
+                        double angle = 0;
+                        for (auto& corner : c)
+                        {
+                            angle = std::max(angle, central_angle(axis, corner));
+                        }
+                        for (size_t i = g.owned_offsets[b]; i < g.owned_offsets[b + 1]; ++i)
+                        {
+                            angle = std::max(angle, central_angle(axis, glm::dvec3(verts[g.owned_ids[i]].pos)));
+                        }
+                        g.owned_cones[b] = { glm::vec3(axis), float(angle + nearest::cone_slack) };
+                    }
+                    metrics->advance(end - begin);
+                }, 1 << 12);
+            g.offsets = mhy::range<const uint32_t>(g.owned_offsets.data(), g.owned_offsets.size());
+            g.vertex_ids = mhy::range<const uint32_t>(g.owned_ids.data(), g.owned_ids.size());
+            g.cones = mhy::range<const VertexCone>(g.owned_cones.data(), g.owned_cones.size());
+            return g;
+        }
+
+        //-- Persist `level`'s vertex grid (default, the finest) into the globe
+        // file, for load_from_mesh() to map, with its bucket level's
+        // connectivity, which queries walk, unless the file has that already.
+        bool write_vertex_grid(const char* fname, int level = -1) const
+        {
+            auto& g = get_vertex_grid(level);
+            if (!g)
+            {
+                return false;
+            }
+            if (!find_chunk(eChunkFaceAdjacency, g.bucket_level) && !write_connectivity(fname, g.bucket_level))
+            {
+                return false;
+            }
+            auto phase = metrics->phase("write_vertex_grid", g.level, g.vertex_ids.size());
+            ChunkAppender out(fname);
+            if (!out)
+            {
+                return false;
+            }
+            const globe_vertex_grid_ext ext = { .bucket_level = g.bucket_level };
+            out.begin_chunk(eChunkGridOffsets, g.level, sizeof(uint32_t), g.offsets.size(), &ext, sizeof(ext));
+            out.write(g.offsets.begin(), g.offsets.size() * sizeof(uint32_t));
+            out.begin_chunk(eChunkGridVerts, g.level, sizeof(uint32_t), g.vertex_ids.size());
+            out.write(g.vertex_ids.begin(), g.vertex_ids.size() * sizeof(uint32_t));
+            out.begin_chunk(eChunkGridCones, g.level, sizeof(VertexCone), g.cones.size());
+            out.write(g.cones.begin(), g.cones.size() * sizeof(VertexCone));
+            const bool ok = out.finish();
+            metrics->add(eCountBytesWritten, out.bytes_written());
+            return ok;
+        }
+
+        //-- The `k` vertices of `grid.level` nearest each unit vector of
+        // `points`, nearest first, into hits[i * k, (i + 1) * k). When the
+        // level has fewer than k vertices, the rest are empty hits. Parallel
+        // over points.
+        void nearest_vertices(const VertexGrid& grid, const glm::dvec3* points, size_t count, unsigned k, VertexHit* hits) const
+        {
+            std::fill_n(hits, count * k, VertexHit());
+            if (!grid || !k)
+            {
+                return;
+            }
+            auto& conn = get_connectivity(grid.bucket_level);
+            mhy::parallel_for(count, [&](size_t first, size_t last)
+                {
+                    GridSearch search(grid.buckets());
+                    std::vector<std::pair<double, uint32_t>> best;
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        best.clear();
+                        grid_search(grid, conn, points[i], search,
+                            [&](uint32_t v, double angle)
+                            {
+                                const std::pair<double, uint32_t> hit(angle, v);
+                                if (best.size() < k)
+                                {
+                                    best.push_back(hit);
+                                    std::push_heap(best.begin(), best.end());
+                                }
+                                else if (hit < best.front())
+                                {
+                                    std::pop_heap(best.begin(), best.end());
+                                    best.back() = hit;
+                                    std::push_heap(best.begin(), best.end());
+                                }
+                            },
+                            [&] { return best.size() < k ? INFINITY : best.front().first; });
+                        std::sort_heap(best.begin(), best.end());
+                        for (size_t j = 0; j < best.size(); ++j)
+                        {
+                            hits[i * k + j] = { best[j].second, (float)best[j].first };
+                        }
+                    }
+                }, 64);
+        }
+
+        //-- The vertices of `grid.level` within `angle` of each unit vector of
+        // `points`, nearest first: point i's are hits[offsets[i], offsets[i + 1]).
+        void vertices_within(const VertexGrid& grid, const glm::dvec3* points, size_t count, double angle,
+                             std::vector<uint32_t>& offsets, std::vector<VertexHit>& hits) const
+        {
+            offsets.assign(count + 1, 0);
+            hits.clear();
+            if (!grid)
+            {
+                return;
+            }
+            auto& conn = get_connectivity(grid.bucket_level);
+            std::vector<std::vector<VertexHit>> found(count);
+            mhy::parallel_for(count, [&](size_t first, size_t last)
+                {
+                    GridSearch search(grid.buckets());
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        std::vector<std::pair<double, uint32_t>> in;
+                        grid_search(grid, conn, points[i], search,
+                            [&](uint32_t v, double a)
+                            {
+                                if (a <= angle)
+                                {
+                                    in.push_back({ a, v });
+                                }
+                            },
+                            [angle] { return angle; });
+                        std::sort(in.begin(), in.end());
+                        found[i].reserve(in.size());
+                        for (auto& h : in)
+                        {
+                            found[i].push_back({ h.second, (float)h.first });
+                        }
+                    }
+                }, 64);
+            for (size_t i = 0; i < count; ++i)
+            {
+                offsets[i + 1] = offsets[i] + (uint32_t)found[i].size();
+            }
+            hits.reserve(offsets.back());
+            for (auto& f : found)
+            {
+                hits.insert(hits.end(), f.begin(), f.end());
+            }
+        }
+
+    private:
+        //-- Per thread: buckets seen, stamped per query, and those to search.
+        struct GridSearch
+        {
+            std::vector<uint32_t>                    seen;
+            uint32_t                                 serial = 0;
+            std::vector<std::pair<double, uint32_t>> frontier;  // min-heap on lower bound
+
+            explicit GridSearch(size_t buckets) : seen(buckets, 0) {}
+        };
+
+        //-- Buckets nearest cone first from the one holding `p`, until the
+        // next is beyond reach(). visit(vertex, angle) for each vertex.
+        template <class Visit, class Reach>
+        void grid_search(const VertexGrid& grid, const LevelConnectivity& conn, const glm::dvec3& p,
+                         GridSearch& s, Visit&& visit, Reach&& reach) const
+        {
+            if (++s.serial == 0)
+            {
+                std::fill(s.seen.begin(), s.seen.end(), 0);
+                s.serial = 1;
+            }
+            auto& verts = vertices.get_indices();
+            glm::dvec3 w;
+            const uint32_t start = walk_to(conn, grid.bucket_level, descend_to(grid.bucket_level, p), p, w);
+            if (start == UINT32_MAX)
+            {
+                return;
+            }
+            auto later = [](auto& a, auto& b) { return a.first > b.first; };
+            s.frontier.clear();
+            s.frontier.push_back({ 0.0, start });
+            s.seen[start] = s.serial;
+            while (!s.frontier.empty())
+            {
+                std::pop_heap(s.frontier.begin(), s.frontier.end(), later);
+                const auto [bound, b] = s.frontier.back();
+                s.frontier.pop_back();
+                if (bound > reach())
+                {
+                    break;
+                }
+                for (size_t i = grid.offsets[b]; i < grid.offsets[b + 1]; ++i)
+                {
+                    const uint32_t v = grid.vertex_ids[i];
+                    visit(v, central_angle(p, glm::dvec3(verts[v].pos)));
+                }
+                for (auto next : conn.adjacency[b].face)
+                {
+                    if (next != no_face && s.seen[next] != s.serial)
+                    {
+                        s.seen[next] = s.serial;
+                        s.frontier.push_back({ nearest::lower_bound(grid.cones[next], p), next });
+                        std::push_heap(s.frontier.begin(), s.frontier.end(), later);
+                    }
+                }
+            }
+        }
+
+    public:
+        //-- Depth first over the face bounds, from the base faces. fn(level,
+        // face, bound) returns true to visit the face's children. Faces are
+        // within their level.
+        template <class Fn>
+        void visit_face_bounds(const FaceBounds& fb, Fn&& fn) const
+        {
+            if (!fb)
+            {
+                return;
+            }
+            std::vector<std::pair<int, uint32_t>> stack;
+            for (size_t f = subdivs[0].offset_end; f-- > 0;)
+            {
+                stack.push_back({ 0, (uint32_t)f });
+            }
+            while (!stack.empty())
+            {
+                const auto [l, f] = stack.back();
+                stack.pop_back();
+                if (fn(l, f, fb.bounds[subdivs[l].offset_begin + f]) && l < fb.leaf_level)
+                {
+                    for (uint32_t k = 4; k-- > 0;)
+                    {
+                        stack.push_back({ l + 1, 4 * f + k });
+                    }
+                }
+            }
+        }
+
+        //-- Elevations within `cap_angle` radians of unit `center`: a range
+        // that holds them, tight where leaves lie inside the cap.
+        ElevRange elevation_range(const glm::dvec3& center, double cap_angle, int level = -1) const
+        {
+            auto& fb = get_face_bounds(level);
+            ElevRange range;
+            visit_face_bounds(fb, [&](int l, uint32_t, const FaceBound& b)
+                {
+                    const auto overlap = bounds::cap_overlap(b, center, cap_angle);
+                    if (overlap == bounds::eCapOutside || (b.elev_min >= range.min && b.elev_max <= range.max))
+                    {   // nothing here can widen the range.
+                        return false;
+                    }
+                    if (overlap == bounds::eCapInside || l == fb.leaf_level)
+                    {
+                        range.merge(b.elev_min, b.elev_max);
+                        return false;
+                    }
+                    return true;
+                });
+            return range;
+        }
+
+        //-- Is there a vertex of leaf `level` within `cap_angle` radians of
+        // unit `center`, and higher than `elev`?
+        bool any_above(const glm::dvec3& center, double cap_angle, float elev, int level = -1) const
+        {
+            auto& fb = get_face_bounds(level);
+            const double cos_cap = std::cos(cap_angle);
+            bool found = false;
+            visit_face_bounds(fb, [&](int l, uint32_t f, const FaceBound& b)
+                {
+                    if (found || b.elev_max <= elev)
+                    {
+                        return false;
+                    }
+                    const auto overlap = bounds::cap_overlap(b, center, cap_angle);
+                    if (overlap == bounds::eCapInside)
+                    {   // elev_max is one of its leaves' corners.
+                        found = true;
+                    }
+                    else if (overlap == bounds::eCapPartial && l == fb.leaf_level)
+                    {
+                        const auto& tri = triangles[subdivs[l].offset_begin + f];
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            found |= elevation(tri[i]) > elev
+                                     && glm::dot(glm::normalize(glm::dvec3(vertices[tri[i]].pos)), center) >= cos_cap;
+                        }
+                    }
+                    return overlap == bounds::eCapPartial;
+                });
+            return found;
+        }
+
+        //-- Faces to draw for `view`, as ranges of flat face indices, in
+        // order: faces of `level` (default, the finest), culled by the view
+        // frustum and the horizon. With view.lod_angle > 0, a face is drawn
+        // instead of its descendants once it subtends less than lod_angle
+        // from the eye. Where levels meet, T-junctions are left to the
+        // renderer, to hide with skirts or morphing.
+        // The top of the hierarchy is walked here; subtrees from
+        // `cull_seed_level` down, across threads.
+        void cull_faces(const CullView& view, std::vector<DrawRange>& out, int level = -1, const Displacement& disp = {}) const
+        {
+            out.clear();
+            auto& fb = get_face_bounds(level);
+            if (!fb)
+            {
+                return;
+            }
+            float elev_min = INFINITY;
+            for (size_t f = 0; f < subdivs[0].offset_end; ++f)
+            {
+                elev_min = std::min(elev_min, fb.bounds[f].elev_min);
+            }
+            const double r_o = (disp.radius + disp.exaggeration * (double)elev_min) * fb.leaf_sag;
+            const double d = glm::length(view.eye);
+            CullState cs{ fb, view, disp, fb.leaf_level, r_o,
+                          d > 0 ? view.eye / d : glm::dvec3(0.0),
+                          d > r_o ? std::acos(r_o / d) : -1.0 };
+
+            std::vector<CullNode> seeds;
+            std::vector<DrawRange> top;
+            std::vector<size_t> seed_at;    // where each seed's ranges go among `top`'s
+            const int seed_level = std::min(cs.level, cull_seed_level);
+            for (uint32_t f = 0; f < subdivs[0].offset_end; ++f)
+            {
+                cull_walk(cs, { 0, f, cull::ePartial, cull::ePartial }, seed_level, top, &seeds, &seed_at);
+            }
+            std::vector<std::vector<DrawRange>> parts(seeds.size());
+            mhy::parallel_for(seeds.size(), [&](size_t first, size_t last)
+                {
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        cull_walk(cs, seeds[i], cs.level, parts[i], nullptr, nullptr);
+                    }
+                }, 16);
+
+            //-- Stitch back into hierarchy order, merging adjacent runs.
+            size_t next = 0;
+            for (size_t i = 0; i <= seeds.size(); ++i)
+            {
+                const size_t end = i < seeds.size() ? seed_at[i] : top.size();
+                for (; next < end; ++next)
+                {
+                    add_range(out, top[next]);
+                }
+                if (i < seeds.size())
+                {
+                    for (auto& r : parts[i])
+                    {
+                        add_range(out, r);
+                    }
+                }
+            }
+        }
+
+    private:
+        static constexpr int cull_seed_level = 4;   // 5120 subtrees
+
+        struct CullState
+        {
+            const FaceBounds&   fb;
+            const CullView&     view;
+            const Displacement& disp;
+            int                 level = 0;
+            double              r_o = 0;
+            glm::dvec3          eye_dir{};
+            double              eye_angle = -1;
+        };
+
+        struct CullNode
+        {
+            int                level;
+            uint32_t           face;
+            cull::EVisibility  in_frustum;      // of its parent: eVisible skips the test
+            cull::EVisibility  over_horizon;
+        };
+
+        static void add_range(std::vector<DrawRange>& out, DrawRange r)
+        {
+            if (!out.empty() && out.back().first + out.back().count == r.first)
+            {
+                out.back().count += r.count;
+            }
+            else
+            {
+                out.push_back(r);
+            }
+        }
+
+        //-- The level at which a face of `level`, `size` across, and its
+        // descendants, each half the size of its parent, are drawn at
+        // `distance` from the eye: the leaf level without LOD.
+        static int lod_level(const CullState& cs, int level, double size, double distance)
+        {
+            if (cs.view.lod_angle <= 0)
+            {
+                return cs.level;
+            }
+            const double reach = cs.view.lod_angle * std::max(distance, 1e-9);
+            for (; level < cs.level && size >= reach; ++level)
+            {
+                size *= 0.5;
+            }
+            return level;
+        }
+
+        //-- Depth first from `root`. Partly visible nodes at `stop_level`
+        // go to `seeds`, when given, with their place in `out`.
+        void cull_walk(const CullState& cs, CullNode root, int stop_level, std::vector<DrawRange>& out,
+                       std::vector<CullNode>* seeds, std::vector<size_t>* seed_at) const
+        {
+            std::vector<CullNode> stack{ root };
+            while (!stack.empty())
+            {
+                auto node = stack.back();
+                stack.pop_back();
+                const auto& b = cs.fb.bounds[subdivs[node.level].offset_begin + node.face];
+                const auto v = cull::node_volume(b, cs.disp);
+                if (node.in_frustum != cull::eVisible)
+                {
+                    node.in_frustum = cull::frustum(v, cs.view);
+                }
+                if (node.over_horizon != cull::eVisible && node.in_frustum != cull::eHidden)
+                {
+                    node.over_horizon = cull::horizon(v, cs.eye_dir, cs.eye_angle, cs.r_o);
+                }
+                if (node.in_frustum == cull::eHidden || node.over_horizon == cull::eHidden)
+                {
+                    continue;
+                }
+                const double size = 2 * v.r_max * std::sin(v.cone_angle);
+                const double distance = glm::distance(cs.view.eye, v.center);
+                const int near_level = lod_level(cs, node.level, size, distance - v.radius);
+                if (near_level == node.level)
+                {   // draw this face.
+                    add_range(out, { (uint32_t)(subdivs[node.level].offset_begin + node.face), 1 });
+                    continue;
+                }
+                if (node.in_frustum == cull::eVisible && node.over_horizon == cull::eVisible &&
+                    near_level == lod_level(cs, node.level, size, distance + v.radius))
+                {   // all of its descendants, at the one level LOD picks across it.
+                    const int shift = 2 * (near_level - node.level);
+                    add_range(out, { (uint32_t)(subdivs[near_level].offset_begin + ((size_t)node.face << shift)),
+                                     (uint32_t)(size_t(1) << shift) });
+                    continue;
+                }
+                if (seeds && node.level == stop_level)
+                {
+                    seed_at->push_back(out.size());
+                    seeds->push_back(node);
+                    continue;
+                }
+                for (uint32_t k = 4; k-- > 0;)
+                {
+                    stack.push_back({ node.level + 1, 4 * node.face + k, node.in_frustum, node.over_horizon });
+                }
+            }
+        }
+
+    public:
+        //-- Elevation profiles along `paths`, sampled every `spacing` in the
+        // units of `radius`, on the faces of `level` (default, the finest).
+        // Elevations are interpolated across each face from its corners.
+        Profiles profile_paths(const PathSet& paths, double spacing, int level = -1,
+                               double radius = Displacement().radius) const
+        {
+            Profiles out;
+            if (!(spacing > 0 && radius > 0))
+            {
+                std::cout << "profile_paths(): spacing and radius must be positive.\n";
+                return out;
+            }
+            if (subdivs.empty() || !paths.count)
+            {
+                return out;
+            }
+            level = level_or_finest(level);
+            auto& conn = get_connectivity(level);
+            auto phase = metrics->phase("profile_paths", level, paths.count);
+
+            //-- Every point as a unit vector.
+            const size_t npoints = paths.begin[paths.count];
+            std::vector<glm::vec3> units(npoints);
+            mhy::parallel_for(npoints, [&](size_t first, size_t last)
+                {
+                    simd::lat_lon_to_unit_strided(&paths.points[first].x, 2, &units[first].x, 3, last - first);
+                }, 1 << 16);
+
+            //-- Count, then fill in place.
+            const double step = spacing / radius;
+            std::vector<size_t> counts(paths.count);
+            mhy::parallel_for(paths.count, [&](size_t first, size_t last)
+                {
+                    for (size_t p = first; p < last; ++p)
+                    {
+                        const size_t npts = paths.begin[p + 1] - paths.begin[p];
+                        counts[p] = npts ? samples_below(path_length(&units[paths.begin[p]], npts), step) + 1 : 0;
+                    }
+                }, 256);
+            out.begin.assign(paths.count + 1, 0);
+            size_t total = 0;
+            for (size_t p = 0; p < paths.count; ++p)
+            {
+                total += counts[p];
+                if (total > UINT32_MAX)
+                {
+                    std::cout << "profile_paths(): more than " << UINT32_MAX << " samples. Use a larger spacing.\n";
+                    return {};
+                }
+                out.begin[p + 1] = (uint32_t)total;
+            }
+            out.samples.resize(total);
+            mhy::parallel_for(paths.count, [&](size_t first, size_t last)
+                {
+                    for (size_t p = first; p < last; ++p)
+                    {
+                        sample_path(conn, level, &units[paths.begin[p]], paths.begin[p + 1] - paths.begin[p],
+                                    step, radius, &out.samples[out.begin[p]]);
+                    }
+                    metrics->advance(last - first);
+                }, 16);
+            metrics->add(eCountElevsSampled, total);
+            return out;
+        }
+
+
+    private:
+
+        void update_vertex_counts()
+        {
+            auto phase = metrics->phase("update_vertex_counts");
+            auto& mbuf = *gen_file;    // fixup the mapped buffer data-chunks.
+
+            auto const verts_count = get_vertices().size();
+            auto const faces_count = triangles.size();
+            auto const subds_count = subdiv_count();
+
+            //-- get file header
+            auto   phdr = mbuf.cast_to<globe_fileheader>(0);
+            auto   chunk = mbuf.cast_to<globe_chunk_header>();
+            size_t iOffset = phdr->header_bytes;
 
             auto get_next_chunk = [&mbuf](size_t offset)  //
                 {                                               //
@@ -877,7 +4135,7 @@ namespace Globe
                 };
 
             chunk = get_next_chunk(iOffset);
-            print(std::cout << "Subdivs: ", *chunk);
+            print(info() << "Subdivs: ", *chunk);
             auto eType = chunk->chunk_type;
             bool bValidHeaders = true;
             if (eChunkSubdivInfo != eType)
@@ -888,12 +4146,12 @@ namespace Globe
             }
             else
             {
-                std::cout << "Subdivs count was " << chunk->data_count << ". " "Expecting " << subds_count << std::endl;
+                info() << "Subdivs count was " << chunk->data_count << ". " "Expecting " << subds_count << std::endl;
                 chunk->data_count = subds_count;
             }
             iOffset += chunk->header_bytes + chunk->data_size;
             chunk = get_next_chunk(iOffset);
-            print(std::cout << "Faces: ", *chunk);
+            print(info() << "Faces: ", *chunk);
             eType = chunk->chunk_type;
             if (eChunkFaces != eType)
             {
@@ -902,12 +4160,12 @@ namespace Globe
             }
             else
             {
-                std::cout << "Faces count was " << chunk->data_count << ". " "Expecting " << faces_count << std::endl;
+                info() << "Faces count was " << chunk->data_count << ". " "Expecting " << faces_count << std::endl;
                 chunk->data_count = faces_count;
             }
             iOffset += chunk->header_bytes + chunk->data_size;
             chunk = get_next_chunk(iOffset);
-            print(std::cout << "Verts: ", *chunk);
+            print(info() << "Verts: ", *chunk);
             eType = chunk->chunk_type;
             if (eChunkVerts != eType)
             {
@@ -916,130 +4174,878 @@ namespace Globe
             }
             else
             {
-                auto actual_size = chunk->data_count * chunk->data_stride;
-                std::cout << "Verts count was " << chunk->data_count << ". " "Expecting " << verts_count
+                auto actual_size = verts_count * chunk->data_stride;
+                info() << "Verts count was " << chunk->data_count << ". " "Expecting " << verts_count
                     << "\n" "   Data stride is " << chunk->data_stride << ". " " Expecting " << sizeof(SphericalCoord)
                     << ".\n" "   Actual verts data size is " << actual_size << " bytes, " " allocated "
                     << chunk->data_size << ".\n";
 
-                chunk->data_count = verts_count;
-                bValidHeaders = !(actual_size < chunk->data_size);
+                chunk->data_count = verts_count;
+                bValidHeaders = !(chunk->data_size < actual_size);
+            }
+
+            if (!bValidHeaders)
+            {
+                std::cout << "***** Chunk Headers are invalid. Not updating EOF chunk.\n";
+                return;
+            }
+            //-- Fix up verts data size. A mismatch is expected. We allocated extra
+            // because vertex count calcs are subject to inexact vertex merging.
+            chunk->data_size = chunk->data_count * chunk->data_stride;
+            iOffset += chunk->header_bytes + chunk->data_size;
+
+            auto eofChunk = mbuf.cast_to<globe_chunk_header>(iOffset);
+            *eofChunk = {
+                    .chunk_type = eChunkEOF,
+                    .header_bytes = sizeof(globe_chunk_header),
+                    .data_stride = 0,
+                    .data_count = 0,
+                    .data_size = 0,
+            };
+            iOffset += eofChunk->header_bytes;
+            phdr->flags &= ~(eFileBuilding | eFileUvDeferred);
+            info() << "++++ You may safely truncate this data file to " << iOffset << ".\n";
+        }
+
+        //-- The subdivs, faces and verts chunk headers of the file being
+        // generated. Their data sizes are the space allocated.
+        std::array<globe_chunk_header*, 3> gen_chunks()
+        {
+            auto& mbuf = *gen_file;
+            std::array<globe_chunk_header*, 3> chunks;
+            size_t i_offset = mbuf.cast_to<globe_fileheader>(0)->header_bytes;
+            for (auto& chunk : chunks)
+            {
+                chunk = mbuf.cast_to<globe_chunk_header>(i_offset);
+                i_offset += chunk->header_bytes + chunk->data_size;
+            }
+            return chunks;
+        }
+
+        bool checkpoint_due() const
+        {
+            return gen_checkpoints && checkpoint_seconds > 0 &&
+                std::chrono::steady_clock::now() - last_checkpoint >= std::chrono::duration<double>(checkpoint_seconds);
+        }
+
+        //-- Make a build into a file resumable from here: the data so far
+        // reaches the file, then the counts that cover it. A level part
+        // way done is recorded as a short last SubdivLevel, `parents_done`
+        // of its parents split.
+        void checkpoint(size_t parents_done)
+        {
+            if (!gen_checkpoints)
+            {
+                return;
+            }
+            gen_file->flush();
+            auto chunks = gen_chunks();
+            size_t nsubdivs = subdivs.size();
+            if (parents_done)
+            {
+                subdivs.data()[nsubdivs++] = { subdivs.back().offset_end, triangles.size(), vertices.get_indices().size() };
+            }
+            chunks[0]->data_count = nsubdivs;
+            chunks[1]->data_count = triangles.size();
+            chunks[2]->data_count = vertices.get_indices().size();
+            gen_file->flush();
+            last_checkpoint = std::chrono::steady_clock::now();
+            info() << "Checkpoint: level " << subdivs.size() << ", " << parents_done << " parents done.\n";
+        }
+
+        //-- Take up a build of `faces0` base faces that checkpointed into
+        // `fname`, to carry on to `nsubdivs`, from the level and parent it
+        // returns in `first_parent`. False, leaving the file be, if there is
+        // none. The build made the vertices from `own_verts` on, or from
+        // the base's end.
+        bool resume_build(const char* fname, size_t faces0, unsigned nsubdivs, size_t& first_parent, size_t own_verts = 0)
+        {
+            std::ifstream probe(fname, std::ios::binary | std::ios::ate);
+            const size_t flen = probe ? (size_t)probe.tellg() : 0;
+            globe_fileheader fheader;
+            if (flen < sizeof(fheader) || !probe.seekg(0).read(reinterpret_cast<char*>(&fheader), sizeof(fheader)) ||
+                fheader.id_word != 0x1234 || !(fheader.flags & eFileBuilding))
+            {
+                return false;
+            }
+            probe.close();
+            auto poo = std::make_unique<mhy::MappedBuffer>(fname, flen, mhy::eMapKeepFile);
+            if (!*poo)
+            {
+                return false;
+            }
+            gen_file.swap(poo);
+            auto chunks = gen_chunks();
+            const size_t capacity[3] = { chunks[0]->data_size / sizeof(SubdivLevel), chunks[1]->data_size / sizeof(Triangle),
+                                         chunks[2]->data_size / sizeof(SphericalCoord) };
+            if (chunks[0]->chunk_type != eChunkSubdivInfo || chunks[1]->chunk_type != eChunkFaces ||
+                chunks[2]->chunk_type != eChunkVerts || capacity[0] != nsubdivs + 1 || !chunks[0]->data_count ||
+                chunks[1]->data_count > capacity[1] || chunks[2]->data_count > capacity[2])
+            {
+                std::cout << "Unfinished globe file '" << fname << "' is not a build of " << nsubdivs << " levels. Starting over.\n";
+                gen_file.reset();
+                return false;
+            }
+            auto list = [&](auto& l, int i)
+                {
+                    using T = typename std::remove_reference_t<decltype(l)>::value_type;
+                    l = mhy::range(reinterpret_cast<T*>(reinterpret_cast<char*>(chunks[i]) + chunks[i]->header_bytes), capacity[i]);
+                    l.resize(chunks[i]->data_count);
+                };
+            list(subdivs, 0);
+            list(triangles, 1);
+            list(get_upd_vertices(), 2);
+            if (subdivs[0].offset_end != faces0)
+            {
+                std::cout << "Unfinished globe file '" << fname << "' is not a build of " << faces0 << " base faces. Starting over.\n";
+                gen_file.reset();
+                return false;
+            }
+
+            //-- A short last level is part way done.
+            first_parent = 0;
+            if (subdivs.size() > 1)
+            {
+                auto& prev = subdivs[subdivs.size() - 2];
+                auto& last = subdivs.back();
+                if (last.offset_end - last.offset_begin < 4 * (prev.offset_end - prev.offset_begin))
+                {
+                    first_parent = (last.offset_end - last.offset_begin) / 4;
+                    subdivs.resize(subdivs.size() - 1);
+                }
+            }
+            const auto& reached = subdivs.data()[first_parent ? subdivs.size() : subdivs.size() - 1];
+            if (reached.offset_end != triangles.size() || reached.vertex_end != vertices.get_indices().size())
+            {
+                std::cout << "Unfinished globe file '" << fname << "' has inconsistent counts. Starting over.\n";
+                gen_file.reset();
+                return false;
+            }
+            if (!take_arena(capacity[2] * merge_node_bytes))
+            {
+                return false;
+            }
+            //-- All of them, in order: merging is inexact, so which vertex a
+            // new one merges with depends on everything in the map.
+            vertices.reindex(0);
+            //-- Lat/lon on file are final, unless the build deferred them:
+            // then all it made are redone, as an unbroken build does.
+            uv_pending = (fheader.flags & eFileUvDeferred) ? std::max(own_verts, (size_t)subdivs[0].vertex_end) : SIZE_MAX;
+            gen_checkpoints = true;
+            last_checkpoint = std::chrono::steady_clock::now();
+            metrics->add(eCountBytesMapped, flen);
+            info() << "Resuming '" << fname << "' at level " << subdivs.size() << ", parent " << first_parent << ".\n";
+            return true;
+        }
+
+        //-- Extra header bytes of each level chunk type, after its globe_level_chunk_header.
+        static size_t level_chunk_ext_bytes(uint16_t chunk_type)
+        {
+            switch (chunk_type)
+            {
+            case eChunkFaceBounds: return sizeof(globe_face_bounds_ext);
+            case eChunkPositions:
+            case eChunkNormals:    return sizeof(globe_displacement_ext);
+            case eChunkPatchOffsets: return sizeof(globe_patches_ext);
+            case eChunkGridOffsets:  return sizeof(globe_vertex_grid_ext);
+            default:               return 0;
+            }
+        }
+
+        //-- A new arena of `bytes` for the vertex merge map. The old map's
+        // nodes live in the old arena, so it goes only once the map has
+        // let go of them.
+        bool take_arena(size_t bytes)
+        {
+            auto arena = std::make_unique<mhy::Arena>(bytes);
+            if (!*arena)
+            {
+                return false;
+            }
+            vertices.use_arena(arena.get());
+            scratch = std::move(arena);
+            return true;
+        }
+
+        //-- Upper bound on one std::map node for the vertex merge map:
+        // the key/value pair plus the tree's color, 3 links, and padding.
+        static constexpr size_t merge_node_bytes = sizeof(std::pair<const SphericalCoord, index_type>) + 5 * sizeof(void*);
+
+        bool create_terrain_mbuf(const char* fname, size_t faces0, unsigned nsubdivs)
+        {
+            //-- calc the space needed for faces.
+            // Level 0: 20 faces. Each subdiv splits each into 4.
+            // Thus, each subdiv level has 4x more faces.
+            size_t nfaces = faces0;  // subd 0 has 20 faces.
+            size_t prev = faces0;
+            for (size_t i : std::ranges::iota_view{ 0u, nsubdivs })
+            {
+                auto sub = prev * 4;
+                nfaces += sub;
+                prev = sub;
+
+                info() << std::setw(8) << (i + 1) << ": +" << sub << " = " << nfaces << std::endl;
+            }
+            //-- There are exactly half as many vertices as there are faces.
+            // (Each face has 3 vertices. Each vertex is shared across 6 faces.
+            // Thus, 3 / 6 = 1/2: half as many vertices as there are faces.)
+            // Add a few extra for the ones that didn't quite merge correctly.
+            //   Allocate for vertices based on the highest subdiv face count,
+            // not the total _cumulative_  counts. Add 0.1% and a few more
+            // for those that didn't merge right.
+            size_t nverts = prev * 501 / 1000 + 10;
+            //-- A shard's faces are open at the seams: each base face has
+            // up to 3 * 2^nsubdivs + 2 more of its own along its edges.
+            if (faces0 < CellId::base_count)
+            {
+                nverts += faces0 * (3 * (size_t(1) << nsubdivs) + 2) / 2;
+            }
+            return create_mbuf(fname, nsubdivs, nfaces, nverts);
+        }
+
+        //-- The file, or anonymous memory, to generate `nsubdivs` levels
+        // into, with room for `nfaces` and `nverts` in all.
+        bool create_mbuf(const char* fname, unsigned nsubdivs, size_t nfaces, size_t nverts)
+        {
+            //-- Allocate space for the file header and 3 chunk headers, for
+            // each of the subdivs summary, faces, and vertices chunks.
+            // clang_format off
+            const size_t flen = sizeof(globe_fileheader) + sizeof(globe_chunk_header) * 3 +
+                sizeof(SubdivLevel) * nsubdivs + sizeof(Triangle) * nfaces +
+                sizeof(SphericalCoord) * nverts;
+            // clang_format on
+
+            info() << "Allocating " << flen << " bytes for " << nfaces << " faces and " << nverts << " vertices.\n";
+
+            //-- No file name: generate into anonymous memory instead.
+            auto poo = fname ? std::make_unique<mhy::MappedBuffer>(fname, flen)
+                             : std::make_unique<mhy::MappedBuffer>(flen, mhy::eMapHugePages);
+            gen_file.swap(poo);
+            auto& mbuf = *gen_file;
+            if (!mbuf)
+            {
+                std::cout << "Error creating globe data file '" << (fname ? fname : "<memory>") << "'.\n";
+                return false;
+            }
+            //-- The vertex merge map holds one node per vertex. Draw them
+            // from a reserved arena rather than the small-object heap.
+            // Pages are committed only as they are touched.
+            if (!take_arena(nverts * merge_node_bytes))
+            {
+                return false;
+            }
+            metrics->add(eCountBytesMapped, flen);
+            //--
+            auto pHeader = write_file_header(mbuf);
+            auto pSubdivs = allocate_data_chunk<SubdivLevel>(pHeader, eChunkSubdivInfo, nsubdivs + 1);
+            auto pFaces = allocate_data_chunk<Triangle>(pSubdivs, eChunkFaces, nfaces);
+            auto pVerts = allocate_data_chunk<SphericalCoord>(pFaces, eChunkVerts, nverts);
+
+            subdivs = pSubdivs;
+            triangles = pFaces;
+            get_upd_vertices() = pVerts;
+
+            //-- Nothing to resume until the first checkpoint.
+            gen_checkpoints = fname != nullptr;
+            if (gen_checkpoints)
+            {
+                pHeader[0].flags |= defer_uv ? eFileBuilding | eFileUvDeferred : eFileBuilding;
+                for (auto chunk : gen_chunks())
+                {
+                    chunk->data_count = 0;
+                }
+                last_checkpoint = std::chrono::steady_clock::now();
+            }
+
+            return true;
+        }
+
+        //-- Resume the build in `fname`, or start it afresh, `make_base()`
+        // laying down its `faces0` base faces, and subdivide to `nsubdivs`,
+        // sampling `terrain` if given.
+        //
+        // The build is pipelined: each level, once made, goes to a worker
+        // that fills in its lat/lon, samples its terrain and starts writing
+        // it to the file, while this thread makes the next. A level's
+        // vertices are final once it is done, and the next level only reads
+        // their positions.
+        template <class Fn>
+        bool build_levels(const char* fname, size_t faces0, unsigned nsubdivs, Fn&& make_base,
+                          const TerrainGrid* terrain = nullptr)
+        {
+            size_t first_parent = 0;
+            const bool resumed = fname && resume_build(fname, faces0, nsubdivs, first_parent);
+            if (!resumed && !create_terrain_mbuf(fname, faces0, nsubdivs))
+            {
+                return false;
+            }
+            staging = std::make_unique<Staging>();
+            staging->terrain = terrain;
+            staging->to_file = fname != nullptr;
+            //-- Taken up, a build's deferred lat/lon is redone from where
+            // resume_build() put uv_pending, and its terrain from the first
+            // vertex; its faces are on file already.
+            staging->verts = terrain ? 0 : std::min(uv_pending, vertices.get_indices().size());
+            staging->faces = triangles.size();
+            try
+            {
+                if (!resumed)
+                {
+                    make_base();
+                    stage_level();
+                    checkpoint(0);
+                }
+                for (auto& level : subdivs)
+                {
+                    stage_level(level.vertex_end, level.offset_end);   // level by level, as they were made
+                }
+                subdivide_from(nsubdivs, first_parent);
+                stage_level();      // the rest of a level taken up, with none to make
+                staging->worker.finish();
+            }
+            catch (...)
+            {
+                staging.reset();
+                throw;
+            }
+            staging.reset();
+            if (terrain)
+            {
+                metrics->add(eCountElevsSampled, vertices.get_indices().size());
+            }
+            uv_pending = SIZE_MAX;
+            //-- all done generating. Update counts in
+            // the file chunk headers.
+            update_vertex_counts();
+            return true;
+        }
+
+        struct Staging
+        {
+            mhy::SerialWorker  worker;
+            const TerrainGrid* terrain = nullptr;
+            bool               to_file = false;
+            size_t             verts = 0;      // staged so far
+            size_t             faces = 0;
+        };
+
+        //-- Hand the vertices and faces made since the last call, up to
+        // `last_vert` and `last_face`, to the worker: lat/lon for those
+        // deferred, terrain, and a start on writing them out. The worker
+        // touches only their uv and elev. Staged a level at a time, the
+        // simd:: blocks fall alike in a build taken up and in one not.
+        void stage_level(size_t last_vert = SIZE_MAX, size_t last_face = SIZE_MAX)
+        {
+            if (!staging)
+            {
+                return;
+            }
+            auto verts = vertices.get_upd_indices().data();
+            const size_t first = staging->verts;
+            const size_t last = std::max(first, std::min(last_vert, vertices.get_indices().size()));
+            const size_t uv_first = std::clamp(uv_pending, first, last);
+            const size_t face_end = std::max(staging->faces, std::min(last_face, triangles.size()));
+            const Triangle* faces = triangles.data() + staging->faces;
+            const size_t nfaces = face_end - staging->faces;
+            staging->verts = last;
+            staging->faces = face_end;
+            if (first == last && !nfaces)
+            {
+                return;
+            }
+            staging->worker.post([this, verts, first, last, uv_first, faces, nfaces,
+                                  terrain = staging->terrain, to_file = staging->to_file]
+                {
+                    mhy::parallel_for(last - uv_first, [verts, uv_first](size_t begin, size_t end)
+                        {
+                            simd::unit_to_lat_lon_strided(&verts[uv_first + begin].pos.x, vertex_stride,
+                                                          &verts[uv_first + begin].uv.x, vertex_stride, end - begin);
+                        }, 1 << 16);
+                    if (terrain)
+                    {
+                        sample_range(*terrain, verts, first, last, [verts](size_t i, int16_t elev) { verts[i].elev = elev; }, false);
+                    }
+                    if (to_file)
+                    {
+                        gen_file->flush_async(faces, nfaces * sizeof(Triangle));
+                        gen_file->flush_async(verts + first, (last - first) * sizeof(SphericalCoord));
+                    }
+                });
+        }
+
+        //-- Cancel the build if asked, resumable from `parents_done` of
+        // the level under way.
+        void stop_if_asked(size_t parents_done)
+        {
+            if (gen_stop.stop_requested())
+            {
+                checkpoint(parents_done);
+                throw cancelled();
             }
+        }
 
-            if (!bValidHeaders)
+        //-- The faces of a regional mesh, found depth first from a base face,
+        // in double. Depth first order is CellId order on every level.
+        struct RegionWalk
+        {
+            const Region&                      region;
+            unsigned                           nsubdivs;
+            std::vector<std::vector<uint64_t>> cells;   // per level
+            std::vector<std::vector<char>>     split;   // per level, but the last
+        };
+
+        static void region_walk(RegionWalk& w, CellId cell, const glm::dvec3 (&c)[3], bool inside)
+        {
+            const int level = cell.level();
+            w.cells[level].push_back(cell.value());
+            if (level == (int)w.nsubdivs)
             {
-                std::cout << "***** Chunk Headers are invalid. Not updating EOF chunk.\n";
                 return;
             }
-            //-- Fix up verts data size. A mismatch is expected. We allocated extra
-            // because vertex count calcs are subject to inexact vertex merging.
-            chunk->data_size = chunk->data_count * chunk->data_stride;
-            iOffset += chunk->header_bytes + chunk->data_size;
-
-            auto eofChunk = mbuf.cast_to<globe_chunk_header>(iOffset);
-            *eofChunk = {
-                    .chunk_type = eChunkEOF,
-                    .header_bytes = sizeof(globe_chunk_header),
-                    .data_stride = 0,
-                    .data_count = 0,
-                    .data_size = 0,
-            };
-            iOffset += eofChunk->header_bytes;
-            std::cout << "++++ You may safely truncate this data file to " << iOffset << ".\n";
+            const auto overlap = inside ? Region::eInside : w.region.overlap(c);
+            w.split[level].push_back(overlap != Region::eOutside);
+            if (overlap == Region::eOutside)
+            {
+                return;
+            }
+            //-- As subdivide_from() splits it.
+            const glm::dvec3 m01 = glm::normalize(c[0] + c[1]);
+            const glm::dvec3 m12 = glm::normalize(c[1] + c[2]);
+            const glm::dvec3 m20 = glm::normalize(c[2] + c[0]);
+            const glm::dvec3 children[4][3] = { { c[0], m01, m20 }, { m01, c[1], m12 }, { m20, m12, c[2] }, { m01, m12, m20 } };
+            for (unsigned k = 0; k < 4; ++k)
+            {
+                region_walk(w, cell.child(k), children[k], overlap == Region::eInside);
+            }
         }
 
-        bool create_terrain_mbuf(const char* fname, size_t faces0, unsigned nsubdivs)
+        //-- Put the shards named in `manifest_name` together into one mesh,
+        // in the globe file `fname`, or in memory if null. Level by level,
+        // shard by shard, each vertex gets the next global id, but for those
+        // on a seam already seen. See globe_shards.h.
+        bool assemble_shards(const char* manifest_name, const char* fname)
         {
-            //-- calc the space needed for faces.
-            // Level 0: 20 faces. Each subdiv splits each into 4.
-            // Thus, each subdiv level has 4x more faces.
-            size_t nfaces = faces0;  // subd 0 has 20 faces.
-            size_t prev = faces0;
-            for (size_t i : std::ranges::iota_view{ 0u, nsubdivs })
+            ShardManifest manifest;
+            if (!manifest.read(manifest_name))
             {
-                auto sub = prev * 4;
-                nfaces += sub;
-                prev = sub;
-
-                std::cout << std::setw(8) << (i + 1) << ": +" << sub << " = " << nfaces << std::endl;
+                return false;
+            }
+            auto phase = metrics->phase("assemble_shards", (int)manifest.levels, manifest.shards.size());
+            const size_t nlevels = manifest.levels + 1;
+            const size_t nparts = manifest.shards.size();
+            std::vector<std::unique_ptr<GlobeMesh>> parts;
+            for (auto& s : manifest.shards)
+            {
+                auto part = std::make_unique<GlobeMesh>();
+                part->set_verbose(false);
+                if (!part->load_from_mesh(s.path.c_str()))
+                {
+                    return false;
+                }
+                if (part->subdivs.size() != nlevels || part->subdivs[0].offset_end != s.base_count)
+                {
+                    std::cout << "Shard '" << s.path << "' is not " << manifest.levels << " subdivisions of "
+                        << s.base_count << " base faces.\n";
+                    return false;
+                }
+                parts.push_back(std::move(part));
             }
-            //-- There are exactly half as many vertices as there are faces.
-            // (Each face has 3 vertices. Each vertex is shared across 6 faces.
-            // Thus, 3 / 6 = 1/2: half as many vertices as there are faces.)
-            // Add a few extra for the ones that didn't quite merge correctly.
-            //   Allocate for vertices based on the highest subdiv face count,
-            // not the total _cumulative_  counts. Add 0.1% and a few more
-            // for those that didn't merge right.
-            const size_t nverts = prev * 501 / 1000 + 10;
 
-            //-- Allocate space for the file header and 3 chunk headers, for
-            // each of the subdivs summary, faces, and vertices chunks.
-            // clang_format off
-            const size_t flen = sizeof(globe_fileheader) + sizeof(globe_chunk_header) * 3 +
-                sizeof(SubdivLevel) * nsubdivs + sizeof(Triangle) * nfaces +
-                sizeof(SphericalCoord) * nverts;
-            // clang_format on
+            //-- Where each shard's vertices lie on its edges with the others.
+            const double eps = shards::seam_eps(manifest.levels);
+            std::vector<std::vector<uint64_t>> seam_keys(nparts);
+            for (size_t k = 0; k < nparts; ++k)
+            {
+                auto& s = manifest.shards[k];
+                auto& part = *parts[k];
+                std::vector<shards::SeamEdge> seams;
+                for (unsigned b = s.first_base; b < s.first_base + s.base_count; ++b)
+                {
+                    const auto& t = part.triangles[b - s.first_base];
+                    for (unsigned e = 0; e < 3; ++e)
+                    {
+                        if (CellId(CellId::from_base(b).neighbor(e).cell).base_face() - s.first_base < s.base_count)
+                        {
+                            continue;
+                        }
+                        const auto& corners = part.vertices.get_indices();
+                        seams.push_back(shards::seam_edge(b, e, glm::dvec3(corners[t[e]].pos), glm::dvec3(corners[t[(e + 1) % 3]].pos)));
+                    }
+                }
+                auto& keys = seam_keys[k];
+                keys.resize(part.vertices.get_indices().size());
+                mhy::parallel_for(keys.size(), [&](size_t first, size_t last)
+                    {
+                        for (size_t v = first; v < last; ++v)
+                        {
+                            const glm::dvec3 p(part.vertices.get_indices()[v].pos);
+                            auto seam = std::find_if(seams.begin(), seams.end(),
+                                                     [&](const shards::SeamEdge& s) { return shards::on_seam(s, p, eps); });
+                            keys[v] = seam == seams.end() ? shards::no_seam : shards::seam_key(*seam, p, manifest.levels);
+                        }
+                    });
+            }
 
-            std::cout << "Allocating " << flen << " bytes for " << nfaces << " faces and " << nverts << " vertices.\n";
+            //-- Global ids, and the levels they make.
+            std::vector<std::vector<index_type>> ids(nparts);
+            std::map<uint64_t, index_type> seam_ids;
+            std::vector<std::pair<glm::dvec3, index_type>> corner_ids;
+            std::vector<SubdivLevel> levels(nlevels);
+            size_t nfaces = 0, nverts = 0;
+            for (size_t l = 0; l < nlevels; ++l)
+            {
+                levels[l].offset_begin = nfaces;
+                for (size_t k = 0; k < nparts; ++k)
+                {
+                    auto& part = *parts[k];
+                    auto& sub = part.subdivs[l];
+                    nfaces += sub.offset_end - sub.offset_begin;
+                    ids[k].resize(sub.vertex_end);
+                    for (size_t v = l ? part.subdivs[l - 1].vertex_end : 0; v < sub.vertex_end; ++v)
+                    {
+                        const uint64_t key = seam_keys[k][v];
+                        if (key == shards::seam_corner)
+                        {
+                            const glm::dvec3 p(part.vertices.get_indices()[v].pos);
+                            auto it = std::find_if(corner_ids.begin(), corner_ids.end(),
+                                                   [&](const auto& c) { return glm::distance(c.first, p) < eps; });
+                            if (it == corner_ids.end())
+                            {
+                                it = corner_ids.insert(it, { p, (index_type)nverts++ });
+                            }
+                            ids[k][v] = it->second;
+                        }
+                        else if (key != shards::no_seam)
+                        {
+                            auto [it, added] = seam_ids.insert({ key, (index_type)nverts });
+                            ids[k][v] = it->second;
+                            nverts += added;
+                        }
+                        else
+                        {
+                            ids[k][v] = (index_type)nverts++;
+                        }
+                    }
+                }
+                levels[l].offset_end = nfaces;
+                levels[l].vertex_end = nverts;
+            }
+            if (nverts > std::numeric_limits<index_type>::max())
+            {
+                std::cout << "Shards of '" << manifest_name << "' have more vertices than a globe file holds.\n";
+                return false;
+            }
 
-            //--
-            auto poo = std::make_unique<mhy::MappedBuffer>(fname, flen);
-            gen_file.swap(poo);
-            auto& mbuf = *gen_file;
-            if (!mbuf)
+            const size_t flen = sizeof(globe_fileheader) + sizeof(globe_chunk_header) * 4 + sizeof(SubdivLevel) * nlevels +
+                sizeof(Triangle) * nfaces + sizeof(SphericalCoord) * nverts;
+            auto poo = fname ? std::make_unique<mhy::MappedBuffer>(fname, flen)
+                             : std::make_unique<mhy::MappedBuffer>(flen, mhy::eMapHugePages);
+            if (!*poo)
             {
-                std::cout << "Error creating globe data file '" << fname << "'.\n";
+                std::cout << "Error creating globe data file '" << (fname ? fname : "<memory>") << "'.\n";
                 return false;
             }
-            //--
-            auto pHeader = write_file_header(mbuf);
-            auto pSubdivs = allocate_data_chunk<SubdivLevel>(pHeader, eChunkSubdivInfo, nsubdivs + 1);
+            metrics->add(eCountBytesMapped, flen);
+            auto pHeader = write_file_header(*poo);
+            auto pSubdivs = allocate_data_chunk<SubdivLevel>(pHeader, eChunkSubdivInfo, nlevels);
             auto pFaces = allocate_data_chunk<Triangle>(pSubdivs, eChunkFaces, nfaces);
             auto pVerts = allocate_data_chunk<SphericalCoord>(pFaces, eChunkVerts, nverts);
+            write_eof_chunk(pVerts);
+            std::copy(levels.begin(), levels.end(), pSubdivs.begin());
 
-            subdivs = pSubdivs;
-            triangles = pFaces;
-            get_upd_vertices() = pVerts;
+            //-- Seam vertices come from each shard that has them: the owner,
+            // the first, goes last.
+            for (size_t k = nparts; k-- > 0;)
+            {
+                auto& verts = parts[k]->vertices.get_indices();
+                mhy::parallel_for(verts.size(), [&](size_t first, size_t last)
+                    {
+                        for (size_t v = first; v < last; ++v)
+                        {
+                            pVerts[ids[k][v]] = verts[v];
+                        }
+                    });
+            }
+            size_t out = 0;
+            for (size_t l = 0; l < nlevels; ++l)
+            {
+                for (size_t k = 0; k < nparts; ++k)
+                {
+                    auto faces = slice(parts[k]->triangles, parts[k]->subdivs[l].faces());
+                    auto& map = ids[k];
+                    mhy::parallel_for(faces.size(), [&](size_t first, size_t last)
+                        {
+                            for (size_t f = first; f < last; ++f)
+                            {
+                                pFaces[out + f] = { map[faces[f][0]], map[faces[f][1]], map[faces[f][2]] };
+                            }
+                        });
+                    out += faces.size();
+                    metrics->progress(out);
+                }
+            }
+            if (fname)
+            {
+                poo->flush();
+            }
+            info() << "Assembled " << nparts << " shards: " << nfaces << " faces, " << nverts << " vertices.\n";
 
+            subdivs.load_from(pSubdivs);
+            triangles.load_from(pFaces);
+            get_upd_vertices().load_from(pVerts);
+            connectivity.clear();
+            face_bounds.clear();
+            patch_levels.clear();
+            vertex_grids.clear();
+            chunk_dir.clear();
+            load_file.reset();
+            gen_file.swap(poo);
             return true;
         }
     public:
+        //-- `fname` may be null to generate into anonymous memory, without
+        // a data file. Practical for low subdiv levels. `fterrain`
+        // may also be null to skip loading terrain elevations.
+        // A build into a file checkpoints as it goes. Run again after a
+        // crash, with the same `nsubdivs`, to resume from the last one.
         bool generate(const char* fname, const char* fterrain, unsigned nsubdivs)
         {
-            std::cout << "Generating Globe with " << nsubdivs << " subdivisions to file " << fname << ".\n";
+            info() << "Generating Globe with " << nsubdivs << " subdivisions to "
+                << (fname ? "file " : "") << (fname ? fname : "memory") << ".\n";
 
             try {
-                if (!create_terrain_mbuf(fname, 20, nsubdivs))
+                auto phase = metrics->phase("generate", (int)nsubdivs);
+                auto build = [&](const TerrainGrid* terrain)
+                    {
+                        return build_levels(fname, CellId::base_count, nsubdivs, [this] { make_globe(); }, terrain);
+                    };
+                //-- The terrain is opened first, to sample each level as it is made.
+                bool built = false;
+                if (fterrain)
+                {
+                    with_terrain(fterrain, [&](const TerrainGrid& grid) { built = build(&grid); });
+                }
+                else
+                {
+                    built = build(nullptr);
+                }
+                if (!built)
                 {
                     return false;
                 }
-                make_globe();
-                subdivide(nsubdivs);
-                //-- all done generating. Update counts in
-                // the file chunk headers.
+            }
+            catch (const cancelled& ex)
+            {
+                std::cout << ex.what() << (fname ? " Generate again to resume.\n" : "\n");
+                return false;
+            }
+            catch (const std::exception& ex)
+            {
+                std::cout << "EXCEPTION: " << ex.what();
+                return false;
+            }
+
+            return true;
+        }
+        bool generate_in_memory(const char* fterrain, unsigned nsubdivs)
+        {
+            return generate(nullptr, fterrain, nsubdivs);
+        }
+
+        //-- generate() on a thread of its own, for services. Its future is
+        // the result. `stop` cancels it between batches of faces: a build
+        // into a file checkpoints first, and generating it again resumes
+        // it. Leave the mesh alone, and alive, until the future is ready.
+        std::future<bool> generate_async(const char* fname, const char* fterrain, unsigned nsubdivs,
+                                         std::stop_token stop = {})
+        {
+            return std::async(std::launch::async,
+                [this, stop, nsubdivs, file = std::string(fname ? fname : ""), terrain = std::string(fterrain ? fterrain : "")]
+                {
+                    gen_stop = stop;
+                    const bool ok = generate(file.empty() ? nullptr : file.c_str(), terrain.empty() ? nullptr : terrain.c_str(), nsubdivs);
+                    gen_stop = {};
+                    return ok;
+                });
+        }
+
+        //-- Carry the globe file `fname` on to `nsubdivs` levels, from where
+        // it stopped. The build goes to `fname`.partial, checkpointing as
+        // generate() does, and replaces `fname` when done, with its level
+        // chunks carried over. Run again after a crash to resume. The
+        // result is left loaded, as by load_from_mesh().
+        bool extend(const char* fname, unsigned nsubdivs)
+        {
+            const std::string building = std::string(fname) + ".partial";
+            info() << "Extending Globe file " << fname << " to " << nsubdivs << " subdivisions.\n";
+            try {
+                auto phase = metrics->phase("extend", (int)nsubdivs);
+                if (!load_from_mesh(fname))
+                {
+                    return false;
+                }
+                if (subdivs.size() > nsubdivs)
+                {
+                    std::cout << "Globe file '" << fname << "' already has " << subdivs.size() - 1 << " subdivisions.\n";
+                    return false;
+                }
+                if (!has_full_levels("extend"))
+                {
+                    return false;
+                }
+                size_t first_parent = 0;
+                if (!resume_build(building.c_str(), subdivs[0].offset_end, nsubdivs, first_parent, vertices.get_indices().size()))
+                {
+                    //-- Copy the levels we have to the front of the new file.
+                    const mhy::RangeT<const SubdivLevel> old_subdivs(subdivs.begin(), subdivs.size());
+                    const mhy::RangeT<const Triangle> old_faces(triangles.begin(), triangles.size());
+                    const mhy::RangeT<const SphericalCoord> old_verts(vertices.get_indices().begin(), vertices.get_indices().size());
+                    if (!create_terrain_mbuf(building.c_str(), old_subdivs[0].offset_end, nsubdivs))
+                    {
+                        return false;
+                    }
+                    std::copy(old_subdivs.begin(), old_subdivs.end(), subdivs.begin());
+                    std::copy(old_faces.begin(), old_faces.end(), triangles.begin());
+                    std::copy(old_verts.begin(), old_verts.end(), get_upd_vertices().begin());
+                    subdivs.resize(old_subdivs.size());
+                    triangles.resize(old_faces.size());
+                    get_upd_vertices().resize(old_verts.size());
+                    vertices.reindex(0);
+                    checkpoint(0);
+                }
+                subdivide_from(nsubdivs, first_parent);
+                compute_uv();
                 update_vertex_counts();
 
-                load_from_terrain(fterrain);
+                //-- Level chunks stay valid: earlier levels are unchanged.
+                ChunkAppender out(building.c_str());
+                if (!out)
+                {
+                    return false;
+                }
+                for (auto& entry : chunk_dir)
+                {
+                    if (entry.level < 0 || !is_level_chunk(entry.chunk_type))
+                    {
+                        continue;
+                    }
+                    const size_t ext_bytes = level_chunk_ext_bytes(entry.chunk_type);
+                    out.begin_chunk((EChunkType)entry.chunk_type, entry.level, entry.data_stride, entry.data_count,
+                                    load_file->cast_to<const char>(entry.header_offset + sizeof(globe_level_chunk_header)), ext_bytes);
+                    out.write(load_file->cast_to<const char>(entry.data_offset), entry.data_stride * entry.data_count);
+                }
+                if (!out.finish())
+                {
+                    return false;
+                }
+                metrics->add(eCountBytesWritten, out.bytes_written());
             }
             catch (const std::exception& ex)
             {
                 std::cout << "EXCEPTION: " << ex.what();
                 return false;
             }
+            gen_file->flush();
+            gen_file.reset();
+            load_file.reset();
+            std::error_code err;
+            std::filesystem::rename(building, fname, err);
+            if (err)
+            {
+                std::cout << "Could not replace '" << fname << "' with '" << building << "': " << err.message() << "\n";
+                load_from_mesh(fname);
+                return false;
+            }
+            return load_from_mesh(fname);
+        }
 
-            return true;
+        //-- One shard of a globe: base faces [first_base, first_base +
+        // base_count), subdivided to `nsubdivs` into `fname`. Its faces are
+        // the whole globe's, in the same order, its vertices its own, with
+        // elevations from `fterrain` unless it is null. Resumes as
+        // generate() does. See globe_shards.h.
+        bool generate_shard(const char* fname, const char* fterrain, unsigned first_base, unsigned base_count, unsigned nsubdivs)
+        {
+            if (!base_count || first_base + base_count > CellId::base_count)
+            {
+                std::cout << "Shard of base faces [" << first_base << ", " << first_base + base_count
+                    << ") is not within the " << CellId::base_count << ".\n";
+                return false;
+            }
+            info() << "Generating base faces [" << first_base << ", " << first_base + base_count << ") with "
+                << nsubdivs << " subdivisions to file " << fname << ".\n";
+            try {
+                auto phase = metrics->phase("generate_shard", (int)nsubdivs, base_count);
+                auto build = [&](const TerrainGrid* terrain)
+                    {
+                        return build_levels(fname, base_count, nsubdivs, [&] { make_globe(first_base, base_count); }, terrain);
+                    };
+                bool built = false;
+                if (fterrain)
+                {
+                    with_terrain(fterrain, [&](const TerrainGrid& grid) { built = build(&grid); });
+                }
+                else
+                {
+                    built = build(nullptr);
+                }
+                return built;
+            }
+            catch (const std::exception& ex)
+            {
+                std::cout << "EXCEPTION: " << ex.what();
+                return false;
+            }
+        }
+
+        //-- A globe of `nsubdivs` levels as `nshards` shard files, built side
+        // by side, and the manifest `fname` naming them. Each shard maps its
+        // own elevations from `fterrain`, if not null. Run again after a
+        // crash to resume. load_from_mesh(fname) puts the shards together.
+        static bool generate_shards(const char* fname, const char* fterrain, unsigned nsubdivs, unsigned nshards = CellId::base_count)
+        {
+            nshards = std::clamp(nshards, 1u, CellId::base_count);
+            const auto manifest = ShardManifest::split(fname, nsubdivs, nshards);
+            const auto dir = std::filesystem::path(fname).parent_path();
+            std::vector<char> done(nshards);
+            mhy::parallel_for(nshards, [&](size_t first, size_t last)
+                {
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        auto& s = manifest.shards[i];
+                        GlobeMesh shard;
+                        shard.set_verbose(false);
+                        done[i] = shard.generate_shard((dir / s.path).string().c_str(), fterrain, s.first_base, s.base_count, nsubdivs);
+                    }
+                }, 1);
+            if (std::count(done.begin(), done.end(), 0))
+            {
+                return false;
+            }
+            return manifest.write(fname);
+        }
+
+        //-- The shards named by `manifest` as one globe file, `fname`, left
+        // loaded. Vertex ids follow the shards, not those of generate().
+        bool merge_shards(const char* manifest, const char* fname)
+        {
+            info() << "Merging shards of " << manifest << " into file " << fname << ".\n";
+            return assemble_shards(manifest, fname);
         }
+
         bool generate_hexcap(float lat, float lon, const char* fname, const char* fterrain, unsigned nsubdivs)
         {
-            std::cout << "Generating Globe with " << nsubdivs << " subdivisions to file " << fname << ".\n";
+            info() << "Generating Globe with " << nsubdivs << " subdivisions to file " << fname << ".\n";
 
             try {
+                auto phase = metrics->phase("generate_hexcap", (int)nsubdivs);
                 if (!create_terrain_mbuf(fname, 6, nsubdivs))
                 {
                     return false;
                 }
                 make_hexcap(lat, lon);
                 subdivide(nsubdivs);
+                compute_uv();
                 //-- all done generating. Update counts in
                 // the file chunk headers.
                 update_vertex_counts();
@@ -1055,7 +5061,141 @@ namespace Globe
             return true;
         }
 
+        //-- Refine `region` alone to `nsubdivs` levels, into the globe file
+        // `fname`: every level holds the children of the faces before it
+        // that reach into the region. Vertex positions are those of a whole
+        // globe, and the file names every face by CellId and every vertex
+        // by its key, the same as any other mesh would. See globe_region.h.
+        // The result is left loaded, as by load_from_mesh(). Not resumable:
+        // run again after a crash.
+        bool generate_region(const char* fname, const Region& region, unsigned nsubdivs, const char* fterrain = nullptr)
+        {
+            info() << "Generating region of " << nsubdivs << " subdivisions to file " << fname << ".\n";
+            if (region.empty() || nsubdivs > CellId::max_level)
+            {
+                std::cout << "Region is empty, or " << nsubdivs << " subdivisions is past level " << CellId::max_level << ".\n";
+                return false;
+            }
+            try {
+                auto phase = metrics->phase("generate_region", (int)nsubdivs);
+
+                //-- Which faces split, from the base faces of a whole globe.
+                RegionWalk walk{ region, nsubdivs, std::vector<std::vector<uint64_t>>(nsubdivs + 1),
+                                 std::vector<std::vector<char>>(nsubdivs) };
+                {
+                    GlobeMesh base;
+                    base.set_verbose(false);
+                    if (!base.generate_in_memory(nullptr, 0))
+                    {
+                        return false;
+                    }
+                    auto& verts = base.vertices.get_indices();
+                    for (unsigned b = 0; b < CellId::base_count; ++b)
+                    {
+                        const auto& t = base.triangles[b];
+                        const glm::dvec3 c[3] = { glm::dvec3(verts[t[0]].pos), glm::dvec3(verts[t[1]].pos), glm::dvec3(verts[t[2]].pos) };
+                        region_walk(walk, CellId::from_base(b), c, false);
+                    }
+                }
+                std::vector<uint64_t> cells;
+                size_t nsplit = 0;
+                refine_only.clear();
+                for (unsigned l = 0; l <= nsubdivs; ++l)
+                {
+                    cells.insert(cells.end(), walk.cells[l].begin(), walk.cells[l].end());
+                    if (l < nsubdivs)
+                    {
+                        refine_only.insert(refine_only.end(), walk.split[l].begin(), walk.split[l].end());
+                        nsplit += std::count(walk.split[l].begin(), walk.split[l].end(), 1);
+                    }
+                    std::vector<uint64_t>().swap(walk.cells[l]);
+                }
+                //-- Each split adds at most 3 vertices.
+                if (!create_mbuf(fname, nsubdivs, cells.size(), 3 * (CellId::base_count + nsplit)))
+                {
+                    refine_only.clear();
+                    return false;
+                }
+                gen_checkpoints = false;
+                make_globe();
+                subdivide_from(nsubdivs, 0);
+                refine_only.clear();
+                compute_uv();
+                update_vertex_counts();
+                if (fterrain)
+                {
+                    load_from_terrain(fterrain);
+                }
+
+                //-- Vertex keys: base corners, then each split's midpoints,
+                // the corners of its middle child.
+                auto& verts = vertices.get_indices();
+                std::vector<uint64_t> keys(verts.size());
+                for (size_t v = 0; v < subdivs[0].vertex_end; ++v)
+                {
+                    keys[v] = region::corner_key(glm::dvec3(verts[v].pos));
+                }
+                for (unsigned l = 0; l < nsubdivs; ++l)
+                {
+                    size_t child = subdivs[l + 1].offset_begin;
+                    for (size_t f = subdivs[l].offset_begin; f < subdivs[l].offset_end; ++f)
+                    {
+                        if (!walk.split[l][f - subdivs[l].offset_begin])
+                        {
+                            continue;
+                        }
+                        const auto& mid = triangles[child + 3];
+                        for (unsigned e = 0; e < 3; ++e)
+                        {
+                            if (!keys[mid[e]])
+                            {
+                                keys[mid[e]] = region::edge_key(CellId(cells[f]), e);
+                            }
+                        }
+                        child += 4;
+                    }
+                }
+                gen_file->flush();
+                if (!append_level_chunks(fname, { { eChunkCellIds, (int)nsubdivs, sizeof(uint64_t), cells.size(), cells.data() },
+                                                  { eChunkVertexKeys, (int)nsubdivs, sizeof(uint64_t), keys.size(), keys.data() } }))
+                {
+                    return false;
+                }
+                info() << "Region: " << cells.size() << " faces, " << keys.size() << " vertices.\n";
+            }
+            catch (const std::exception& ex)
+            {
+                refine_only.clear();
+                std::cout << "EXCEPTION: " << ex.what();
+                return false;
+            }
+            gen_file.reset();
+            return load_from_mesh(fname);
+        }
+
+        //-- CellIds of a regional mesh's faces, by flat face index, from
+        // the loaded file, or empty.
+        mhy::RangeT<const uint64_t> get_cell_ids() const
+        {
+            auto entry = find_chunk(eChunkCellIds, (int)subdivs.size() - 1);
+            if (!entry || entry->data_stride != sizeof(uint64_t) || entry->data_count != triangles.size())
+            {
+                return {};
+            }
+            return mhy::range(load_file->cast_to<const uint64_t>(entry->data_offset), entry->data_count);
+        }
 
+        //-- Keys of a regional mesh's vertices, by vertex id, from the
+        // loaded file, or empty. See globe_region.h.
+        mhy::RangeT<const uint64_t> get_vertex_keys() const
+        {
+            auto entry = find_chunk(eChunkVertexKeys, (int)subdivs.size() - 1);
+            if (!entry || entry->data_stride != sizeof(uint64_t) || entry->data_count != vertices.get_indices().size())
+            {
+                return {};
+            }
+            return mhy::range(load_file->cast_to<const uint64_t>(entry->data_offset), entry->data_count);
+        }
     };
 
 }  // namespace Globe
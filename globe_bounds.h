@@ -0,0 +1,107 @@
+#pragma once
+// Conservative bounds of every face at every level: the least and greatest
+// elevation of the terrain beneath it, and a cone about the origin that
+// holds its wedge.
+//
+// Bounds are indexed as GlobeMesh's `triangles`, by flat face index, for
+// levels 0 up to a leaf level, whose vertices they summarize. A leaf's are
+// from its corners, a parent's from its 4 children, so queries prune whole
+// subtrees without touching vertex data.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mikey_tools.h"
+#include "globe_normals.h"
+#include "globe_sphere.h"
+
+namespace Globe
+{
+    //-- 16 bytes. The cone's half angle is in radians: its cosine is too
+    // close to 1 for a float at fine levels.
+    struct FaceBound
+    {
+        float     elev_min = 0;
+        float     elev_max = 0;
+        OctNormal axis;
+        float     cone_angle = 0;
+    };
+
+    struct FaceBounds
+    {
+        int                           leaf_level = -1;
+        float                         leaf_sag = 1;   // flat leaves dip to this fraction of their corners' radius
+        mhy::RangeT<const FaceBound>  bounds;         // by flat face index
+        std::vector<FaceBound>        owned;
+
+        bool operator!() const
+        {
+            return bounds.empty();
+        }
+    };
+
+    //-- A conservative elevation range, or an empty one, min > max.
+    struct ElevRange
+    {
+        float min = INFINITY;
+        float max = -INFINITY;
+
+        bool empty() const
+        {
+            return min > max;
+        }
+
+        void merge(float lo, float hi)
+        {
+            min = std::min(min, lo);
+            max = std::max(max, hi);
+        }
+    };
+
+    namespace bounds
+    {
+        //-- Float vertex positions tile their parent to about 1e-7.
+        constexpr double cone_slack = 2e-7;
+
+        //-- The cone about a triangle's unit corners: its axis as stored,
+        // and the half angle from that axis. `cos_exact` is the least cosine
+        // from the unquantized axis, the sag of a flat triangle.
+        inline void corner_cone(const glm::dvec3 (&unit)[3], FaceBound& b, double& cos_exact)
+        {
+            const glm::dvec3 n = glm::normalize(unit[0] + unit[1] + unit[2]);
+            b.axis = oct_encode(n);
+            const glm::dvec3 q(oct_decode(b.axis));
+            double angle = 0;
+            cos_exact = 1;
+            for (int i = 0; i < 3; ++i)
+            {
+                angle = std::max(angle, central_angle(q, unit[i]));
+                cos_exact = std::min(cos_exact, glm::dot(n, unit[i]));
+            }
+            b.cone_angle = (float)(angle + cone_slack);
+        }
+
+        //-- Where a face's cone lies against a cap about unit `center`.
+        enum ECapOverlap
+        {
+            eCapOutside,
+            eCapPartial,
+            eCapInside,
+        };
+
+        inline ECapOverlap cap_overlap(const FaceBound& b, const glm::dvec3& center, double cap_angle)
+        {
+            const double gap = central_angle(glm::dvec3(oct_decode(b.axis)), center);
+            if (gap > cap_angle + b.cone_angle)
+            {
+                return eCapOutside;
+            }
+            return gap + b.cone_angle <= cap_angle ? eCapInside : eCapPartial;
+        }
+    }  // namespace bounds
+
+}  // namespace Globe
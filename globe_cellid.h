@@ -0,0 +1,256 @@
+#pragma once
+// Hierarchical 64-bit cell ids for faces of the subdivided icosahedron.
+//
+// A face at level L is one of the 20 base faces, then one child position
+// (0..3) per level, in the order subdivide() emits them:
+//     0 {t0, m01, m20}   1 {m01, t1, m12}   2 {m20, m12, t2}   3 {m01, m12, m20}
+// That is exactly the face's index within its level, base * 4^L + digits,
+// so conversion to and from GlobeMesh's flat `triangles` index is O(1).
+//
+// Bit layout, after S2: the face index sits at the top, followed by a single
+// sentinel 1 bit that marks the level, then zeros.
+//     [ base:5 ][ child:2 ] x L [ 1 ][ 0 ... ]
+// Ids order depth first, so every descendant of a cell lies in
+// [range_min(), range_max()] and a subtree is one contiguous range scan.
+//
+// Edges are numbered from the face's corners: edge e runs from corner e to
+// corner (e + 1) % 3. neighbor() crosses an edge, climbing only as far as
+// the nearest ancestor that holds both faces, or to the base face table at
+// the seams: constant time on average, at most `level` steps.
+//
+// Only meaningful for meshes built by make_globe(), not hexcaps.
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <ostream>
+#include <iomanip>
+
+namespace Globe
+{
+    class CellId
+    {
+    public:
+        static constexpr int      max_level = 29;
+        static constexpr unsigned base_count = 20;
+
+        //-- A neighbor, and the index of the shared edge on its side.
+        struct Edge
+        {
+            uint64_t cell;
+            unsigned edge;
+        };
+
+    private:
+        static constexpr int base_shift = 59;   // 64 - 5 bits for the base face
+
+        uint64_t id = 0;
+
+        //-- Neighbors of the 20 base faces across edges 0, 1, 2, from the
+        // face order in make_globe(). The shared edge runs the other way.
+        static constexpr Edge base_neighbors[base_count][3] = {
+            {{  4, 2 }, {  1, 2 }, { 16, 0 }},   // 0
+            {{  2, 2 }, { 18, 0 }, {  0, 1 }},   // 1
+            {{  5, 1 }, {  3, 0 }, {  1, 0 }},   // 2
+            {{  2, 1 }, {  7, 2 }, { 19, 1 }},   // 3
+            {{  8, 2 }, {  5, 2 }, {  0, 0 }},   // 4
+            {{  6, 2 }, {  2, 0 }, {  4, 1 }},   // 5
+            {{  9, 1 }, {  7, 0 }, {  5, 0 }},   // 6
+            {{  6, 1 }, { 11, 2 }, {  3, 1 }},   // 7
+            {{ 12, 2 }, {  9, 2 }, {  4, 0 }},   // 8
+            {{ 10, 2 }, {  6, 0 }, {  8, 1 }},   // 9
+            {{ 13, 1 }, { 11, 0 }, {  9, 0 }},   // 10
+            {{ 10, 1 }, { 15, 2 }, {  7, 1 }},   // 11
+            {{ 16, 2 }, { 13, 2 }, {  8, 0 }},   // 12
+            {{ 14, 2 }, { 10, 0 }, { 12, 1 }},   // 13
+            {{ 17, 1 }, { 15, 0 }, { 13, 0 }},   // 14
+            {{ 14, 1 }, { 19, 2 }, { 11, 1 }},   // 15
+            {{  0, 2 }, { 17, 2 }, { 12, 0 }},   // 16
+            {{ 18, 2 }, { 14, 0 }, { 16, 1 }},   // 17
+            {{  1, 1 }, { 19, 0 }, { 17, 0 }},   // 18
+            {{ 18, 1 }, {  3, 2 }, { 15, 1 }},   // 19
+        };
+
+        constexpr uint64_t lsb() const
+        {
+            return id & (~id + 1);
+        }
+
+    public:
+        constexpr CellId() = default;
+        constexpr explicit CellId(uint64_t id) : id(id) {}
+
+        //==========
+        //-- Faces at `level`, and where that level starts in the flat list.
+        static constexpr uint64_t level_faces(int level)
+        {
+            return uint64_t(base_count) << (2 * level);
+        }
+        static constexpr uint64_t level_offset(int level)
+        {
+            return base_count * ((uint64_t(1) << (2 * level)) - 1) / 3;
+        }
+
+        //-- `face` is the index within `level`: base * 4^level + digits.
+        static constexpr CellId from_face(int level, uint64_t face)
+        {
+            return CellId((face << (base_shift - 2 * level)) | (uint64_t(1) << (base_shift - 1 - 2 * level)));
+        }
+
+        //-- `index` into the flat triangle list, all levels from 0 up.
+        static constexpr CellId from_flat(uint64_t index)
+        {
+            // index / 20 * 3, without overflow, finds 4^level.
+            const uint64_t q = index / base_count * 3 + index % base_count * 3 / base_count + 1;
+            const int level = (std::bit_width(q) - 1) / 2;
+            return from_face(level, index - level_offset(level));
+        }
+
+        static constexpr CellId from_base(unsigned base)
+        {
+            return from_face(0, base);
+        }
+
+        //==========
+        constexpr uint64_t value() const
+        {
+            return id;
+        }
+
+        constexpr bool is_valid() const
+        {
+            const int tz = std::countr_zero(id);
+            return id && tz < base_shift && (base_shift - 1 - tz) % 2 == 0 && base_face() < base_count;
+        }
+
+        constexpr int level() const
+        {
+            return (base_shift - 1 - std::countr_zero(id)) / 2;
+        }
+
+        constexpr unsigned base_face() const
+        {
+            return unsigned(id >> base_shift);
+        }
+
+        //-- Index within this cell's level.
+        constexpr uint64_t face() const
+        {
+            return id >> (std::countr_zero(id) + 1);
+        }
+
+        constexpr uint64_t flat_index() const
+        {
+            return level_offset(level()) + face();
+        }
+
+        //-- Which child of its parent this is, 0..3. Undefined at level 0.
+        constexpr unsigned child_position() const
+        {
+            return unsigned(id >> (std::countr_zero(id) + 1)) & 3;
+        }
+
+        //==========
+        //-- Undefined at level 0, as a base face has no parent.
+        constexpr CellId parent() const
+        {
+            const uint64_t bit = lsb() << 2;
+            return CellId((id & (~bit + 1)) | bit);
+        }
+
+        //-- The ancestor at `level`, from 0 to this cell's level.
+        constexpr CellId parent(int level) const
+        {
+            const uint64_t bit = uint64_t(1) << (base_shift - 1 - 2 * level);
+            return CellId((id & (~bit + 1)) | bit);
+        }
+
+        //-- Child k, 0..3. Undefined at max_level.
+        constexpr CellId child(unsigned k) const
+        {
+            const uint64_t bit = lsb() >> 2;
+            return CellId(id - (bit << 2) + (uint64_t(k) << 1 | 1) * bit);
+        }
+
+        //-- Every descendant of this cell, at any level, lies in this range.
+        constexpr CellId range_min() const
+        {
+            return CellId(id - (lsb() - 1));
+        }
+        constexpr CellId range_max() const
+        {
+            return CellId(id + (lsb() - 1));
+        }
+        constexpr bool contains(CellId other) const
+        {
+            return range_min().id <= other.id && other.id <= range_max().id;
+        }
+
+        //==========
+        //-- The face across `edge` (0..2), at the same level.
+        constexpr Edge neighbor(unsigned edge) const
+        {
+            const int level = this->level();
+            uint64_t  cur = face();
+            unsigned  e = edge;
+            uint64_t  halves = 0;   // per level climbed: which half of the parent's edge
+            int       up = 0;
+            for (;; cur >>= 2, ++up)
+            {
+                if (up == level)
+                {   // crossed a base face seam.
+                    const auto& nb = base_neighbors[cur][e];
+                    cur = nb.cell;
+                    e = nb.edge;
+                    break;
+                }
+                const unsigned k = cur & 3;
+                if (k == 3)
+                {   // the center child borders each corner child.
+                    cur = (cur & ~uint64_t(3)) | ((e + 1) % 3);
+                    e = (e + 2) % 3;
+                    break;
+                }
+                if (e == (k + 1) % 3)
+                {   // a corner child's inner edge borders the center child.
+                    cur |= 3;
+                    e = (k + 2) % 3;
+                    break;
+                }
+                // on the parent's edge e: its first half from child e, the second from e + 1.
+                halves |= uint64_t(k != e) << up;
+            }
+            while (up-- > 0)
+            {   // back down the other side, where the shared edge runs the other way.
+                const unsigned h = (halves >> up) & 1;
+                cur = (cur << 2) | ((e + 1 - h) % 3);
+            }
+            return { from_face(level, cur).id, e };
+        }
+
+        constexpr std::array<CellId, 3> neighbors() const
+        {
+            return { CellId(neighbor(0).cell), CellId(neighbor(1).cell), CellId(neighbor(2).cell) };
+        }
+
+        //==========
+        constexpr bool operator==(const CellId& rhs) const = default;
+        constexpr auto operator<=>(const CellId& rhs) const = default;
+    };
+
+    //-- "b07:0312", base face then the child positions.
+    inline std::ostream& operator<<(std::ostream& os, CellId c)
+    {
+        if (!c.is_valid())
+        {
+            return os << "invalid:" << std::hex << c.value() << std::dec;
+        }
+        os << 'b' << std::setfill('0') << std::setw(2) << c.base_face() << std::setfill(' ') << ':';
+        for (int l = 1; l <= c.level(); ++l)
+        {
+            os << c.parent(l).child_position();
+        }
+        return os;
+    }
+
+}  // namespace Globe
@@ -0,0 +1,217 @@
+#pragma once
+// Per-level mesh connectivity: face-face adjacency, the vertex one-ring
+// (vertex -> incident faces, in CSR form), and the edge list.
+//
+// Face indices are within the level, as in Slice<> from get_faces(level);
+// vertex indices are global, as in the faces themselves. Edge e of a face
+// runs from corner e to corner (e + 1) % 3.
+//
+// The builders are parallel and use no hash maps: counts and fills are
+// atomic increments into flat arrays, sized up front.
+
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "mikey_tools.h"
+#include "globe_cellid.h"
+
+namespace Globe
+{
+    constexpr uint32_t no_face = UINT32_MAX;    // across an open boundary, e.g. of a hexcap
+
+    //-- Neighbors across edges 0, 1, 2.
+    struct FaceAdjacency
+    {
+        uint32_t face[3];
+    };
+
+    //-- f[0] is the face whose edge runs v[0] -> v[1]. f[1] is across it, or no_face.
+    struct MeshEdge
+    {
+        uint32_t v[2];
+        uint32_t f[2];
+    };
+
+    //-- Connectivity of one level. Views either into a mapped globe file,
+    // or into `owned`, when built in memory.
+    struct LevelConnectivity
+    {
+        struct Storage
+        {
+            std::vector<FaceAdjacency> adjacency;
+            std::vector<uint32_t>      ring_offsets;
+            std::vector<uint32_t>      ring_faces;
+            std::vector<MeshEdge>      edges;
+        };
+
+        int                               level = -1;
+        mhy::RangeT<const FaceAdjacency>  adjacency;
+        mhy::RangeT<const uint32_t>       ring_offsets;   // vertex count + 1
+        mhy::RangeT<const uint32_t>       ring_faces;     // faces about each vertex, ascending
+        mhy::RangeT<const MeshEdge>       edges;
+        std::unique_ptr<Storage>          owned;
+
+        bool operator!() const
+        {
+            return adjacency.empty() || ring_offsets.empty() || edges.empty();
+        }
+
+        //-- Faces incident on `vertex`.
+        mhy::RangeT<const uint32_t> one_ring(uint32_t vertex) const
+        {
+            return mhy::range(ring_faces.begin() + ring_offsets.begin()[vertex],
+                              ring_faces.begin() + ring_offsets.begin()[vertex + 1]);
+        }
+
+        //-- Point the views at `owned`.
+        void use_owned()
+        {
+            adjacency = mhy::range<const FaceAdjacency>(owned->adjacency.data(), owned->adjacency.size());
+            ring_offsets = mhy::range<const uint32_t>(owned->ring_offsets.data(), owned->ring_offsets.size());
+            ring_faces = mhy::range<const uint32_t>(owned->ring_faces.data(), owned->ring_faces.size());
+            edges = mhy::range<const MeshEdge>(owned->edges.data(), owned->edges.size());
+        }
+    };
+
+    namespace connectivity
+    {
+        //-- The one-ring as CSR: count, prefix sum, fill, then sort each ring
+        // so the result does not depend on thread timing.
+        template <class Face>
+        bool build_one_ring(const Face* faces, size_t nfaces, size_t nverts,
+                            std::vector<uint32_t>& offsets, std::vector<uint32_t>& ring)
+        {
+            if (3 * nfaces > UINT32_MAX)
+            {
+                std::cout << "build_one_ring(): " << nfaces << " faces overflow 32 bit ring offsets.\n";
+                return false;
+            }
+            offsets.assign(nverts + 1, 0);
+            mhy::parallel_for(nfaces, [&](size_t first, size_t last)
+                {
+                    for (size_t f = first; f < last; ++f)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            std::atomic_ref<uint32_t>(offsets[faces[f][k] + 1]).fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }, 1 << 16);
+            for (size_t v = 0; v < nverts; ++v)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+
+            ring.resize(offsets[nverts]);
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            mhy::parallel_for(nfaces, [&](size_t first, size_t last)
+                {
+                    for (size_t f = first; f < last; ++f)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            auto at = std::atomic_ref<uint32_t>(cursor[faces[f][k]]).fetch_add(1, std::memory_order_relaxed);
+                            ring[at] = (uint32_t)f;
+                        }
+                    }
+                }, 1 << 16);
+            mhy::parallel_for(nverts, [&](size_t first, size_t last)
+                {
+                    for (size_t v = first; v < last; ++v)
+                    {
+                        std::sort(ring.begin() + offsets[v], ring.begin() + offsets[v + 1]);
+                    }
+                }, 1 << 16);
+            return true;
+        }
+
+        //-- Any mesh: the face across edge (a, b) is the other face in a's
+        // one-ring that also has b. no_face where there is none, which
+        // includes seams where vertex merging failed.
+        template <class Face>
+        void build_adjacency(const Face* faces, size_t nfaces, const uint32_t* offsets,
+                             const uint32_t* ring, FaceAdjacency* out)
+        {
+            mhy::parallel_for(nfaces, [&](size_t first, size_t last)
+                {
+                    for (size_t f = first; f < last; ++f)
+                    {
+                        for (int e = 0; e < 3; ++e)
+                        {
+                            const auto a = faces[f][e];
+                            const auto b = faces[f][(e + 1) % 3];
+                            uint32_t across = no_face;
+                            for (auto g = offsets[a]; g < offsets[a + 1] && across == no_face; ++g)
+                            {
+                                const auto& t = faces[ring[g]];
+                                if (ring[g] != f && (t[0] == b || t[1] == b || t[2] == b))
+                                {
+                                    across = ring[g];
+                                }
+                            }
+                            out[f].face[e] = across;
+                        }
+                    }
+                }, 1 << 14);
+        }
+
+        //-- make_globe() meshes: from cell ids, exact even where vertex
+        // merging failed, and without touching the vertex data.
+        inline void build_adjacency(int level, size_t nfaces, FaceAdjacency* out)
+        {
+            mhy::parallel_for(nfaces, [&](size_t first, size_t last)
+                {
+                    for (size_t f = first; f < last; ++f)
+                    {
+                        const auto cell = CellId::from_face(level, f);
+                        for (unsigned e = 0; e < 3; ++e)
+                        {
+                            out[f].face[e] = (uint32_t)CellId(cell.neighbor(e).cell).face();
+                        }
+                    }
+                }, 1 << 16);
+        }
+
+        //-- Each edge once, from the lower numbered face, in face order.
+        template <class Face>
+        void build_edges(const Face* faces, size_t nfaces, const FaceAdjacency* adj, std::vector<MeshEdge>& edges)
+        {
+            auto owns = [&](size_t f, int e)
+                {
+                    return adj[f].face[e] == no_face || f < adj[f].face[e];
+                };
+            std::vector<uint32_t> first_edge(nfaces + 1, 0);
+            mhy::parallel_for(nfaces, [&](size_t first, size_t last)
+                {
+                    for (size_t f = first; f < last; ++f)
+                    {
+                        first_edge[f + 1] = owns(f, 0) + owns(f, 1) + owns(f, 2);
+                    }
+                }, 1 << 16);
+            for (size_t f = 0; f < nfaces; ++f)
+            {
+                first_edge[f + 1] += first_edge[f];
+            }
+            edges.resize(first_edge[nfaces]);
+            mhy::parallel_for(nfaces, [&](size_t first, size_t last)
+                {
+                    for (size_t f = first; f < last; ++f)
+                    {
+                        auto out = edges.begin() + first_edge[f];
+                        for (int e = 0; e < 3; ++e)
+                        {
+                            if (owns(f, e))
+                            {
+                                *out++ = { { faces[f][e], faces[f][(e + 1) % 3] }, { (uint32_t)f, adj[f].face[e] } };
+                            }
+                        }
+                    }
+                }, 1 << 16);
+        }
+    }  // namespace connectivity
+
+}  // namespace Globe
@@ -0,0 +1,163 @@
+#pragma once
+// Visible faces for a camera: culled by the view frustum, and by the
+// horizon of the planet, with its terrain.
+//
+// The face hierarchy is walked from the base faces, each node bounded by its
+// FaceBound: a cone, and the radii of the displaced terrain beneath it. A
+// node outside the frustum or wholly behind the horizon is dropped with its
+// subtree. One wholly in view is kept whole: its descendants at any level
+// are one contiguous run of faces, so the result is a short list of ranges
+// into the global index buffer, ready for indirect draws.
+//
+// The horizon is that of the occluder sphere, the least radius the drawn
+// surface reaches. A point at radius r is hidden from the eye, at distance d,
+// once its angle from the eye's direction exceeds
+//     acos(r_o / d) + acos(r_o / r)
+
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "globe_bounds.h"
+#include "globe_normals.h"
+#include "globe_sphere.h"
+
+namespace Globe
+{
+    //-- Positions in the units of Displacement::radius, as bake_positions().
+    struct CullView
+    {
+        glm::dvec3 eye;
+        glm::dvec4 planes[6];           // inside where dot(xyz, p) + w >= 0
+        double     lod_angle = 0;       // radians. See GlobeMesh::cull_faces().
+
+        //-- Frustum planes from a view-projection matrix, with clip z in
+        // [-1, 1] as OpenGL, or with `zero_to_one`, in [0, 1] as Vulkan and D3D.
+        static CullView from_view_proj(const glm::dmat4& view_proj, const glm::dvec3& eye, bool zero_to_one = false)
+        {
+            auto row = [&](int i) { return glm::dvec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]); };
+            const glm::dvec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+            CullView view;
+            view.eye = eye;
+            view.planes[0] = r3 + r0;
+            view.planes[1] = r3 - r0;
+            view.planes[2] = r3 + r1;
+            view.planes[3] = r3 - r1;
+            view.planes[4] = zero_to_one ? r2 : r3 + r2;
+            view.planes[5] = r3 - r2;
+            for (auto& p : view.planes)
+            {
+                p /= glm::length(glm::dvec3(p));
+            }
+            return view;
+        }
+    };
+
+    //-- A run of faces, by flat face index, as GlobeMesh's `triangles`.
+    struct DrawRange
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    //-- Laid out as glDrawElementsIndirect() and vkCmdDrawIndexedIndirect() read it.
+    struct DrawElementsIndirect
+    {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t  base_vertex;
+        uint32_t base_instance;
+    };
+
+    inline void to_indirect(const std::vector<DrawRange>& ranges, std::vector<DrawElementsIndirect>& out)
+    {
+        out.resize(ranges.size());
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            out[i] = { 3 * ranges[i].count, 1, 3 * ranges[i].first, 0, 0 };
+        }
+    }
+
+    namespace cull
+    {
+        enum EVisibility
+        {
+            eHidden,
+            ePartial,
+            eVisible,
+        };
+
+        //-- A node's cone, between radii r_min and r_max, and a sphere about it.
+        struct NodeVolume
+        {
+            glm::dvec3 axis;
+            double     cone_angle;
+            double     r_min;
+            double     r_max;
+            glm::dvec3 center;
+            double     radius;
+        };
+
+        //-- Flat triangles drawn from the node dip below their corners by at
+        // most the cos of its cone.
+        inline NodeVolume node_volume(const FaceBound& b, const Displacement& disp)
+        {
+            NodeVolume v;
+            v.axis = glm::dvec3(oct_decode(b.axis));
+            v.cone_angle = b.cone_angle;
+            const double cos_a = std::cos(std::min(v.cone_angle, std::numbers::pi / 2));
+            const double sin_a = std::sin(std::min(v.cone_angle, std::numbers::pi / 2));
+            v.r_max = disp.radius + disp.exaggeration * (double)b.elev_max;
+            v.r_min = (disp.radius + disp.exaggeration * (double)b.elev_min) * cos_a;
+            //-- The farthest points from a center on the axis: the outer
+            // pole, and the rims of the outer and inner caps.
+            const double m = (v.r_min * cos_a + v.r_max) / 2;
+            v.center = v.axis * m;
+            v.radius = std::max({ v.r_max - m, std::hypot(v.r_max * cos_a - m, v.r_max * sin_a),
+                                  std::hypot(v.r_min * cos_a - m, v.r_min * sin_a), std::abs(m - v.r_min) });
+            return v;
+        }
+
+        inline EVisibility frustum(const NodeVolume& v, const CullView& view)
+        {
+            auto vis = eVisible;
+            for (auto& p : view.planes)
+            {
+                const double d = glm::dot(glm::dvec3(p), v.center) + p.w;
+                if (d < -v.radius)
+                {
+                    return eHidden;
+                }
+                if (d < v.radius)
+                {
+                    vis = ePartial;
+                }
+            }
+            return vis;
+        }
+
+        //-- Against the occluder sphere of radius `r_o`. `eye_angle` is the
+        // horizon angle of the eye, acos(r_o / |eye|), or negative with the
+        // eye inside the occluder, where nothing is culled.
+        inline EVisibility horizon(const NodeVolume& v, const glm::dvec3& eye_dir, double eye_angle, double r_o)
+        {
+            if (eye_angle < 0)
+            {
+                return eVisible;
+            }
+            auto horizon_of = [r_o](double r) { return r > r_o ? std::acos(r_o / r) : 0.0; };
+            const double gap = central_angle(v.axis, eye_dir);
+            if (gap - v.cone_angle > eye_angle + horizon_of(v.r_max))
+            {
+                return eHidden;
+            }
+            return gap + v.cone_angle <= eye_angle + horizon_of(v.r_min) ? eVisible : ePartial;
+        }
+    }  // namespace cull
+
+}  // namespace Globe
@@ -0,0 +1,171 @@
+#pragma once
+// glTF 2.0 output of one level of the globe, or a region of it: binary GLB,
+// or JSON with the buffer beside it in a .bin file.
+//
+// The document is one mesh, one triangle list, over one buffer of packed
+// views: indices, then POSITION, NORMAL and TEXCOORD_0. Every size follows
+// from the counts alone, so the JSON goes out first with placeholder bounds,
+// the buffer streams behind it a block at a time, and the JSON is rewritten
+// in place once POSITION's min and max are known. Its numbers are written at
+// a fixed width, to keep its length.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <numbers>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "globe_normals.h"
+
+namespace Globe
+{
+    struct GlbOptions
+    {
+        Displacement disp;
+        bool normals = true;
+        bool texcoords = true;
+        //-- KHR_mesh_quantization: int8 normals, uint16 texcoords, and uint16
+        // indices where the vertices fit.
+        bool compact = false;
+    };
+
+    namespace gltf
+    {
+        constexpr uint32_t glb_magic = 0x46546c67;      // "glTF"
+        constexpr uint32_t glb_version = 2;
+        constexpr uint32_t chunk_json = 0x4e4f534a;     // "JSON"
+        constexpr uint32_t chunk_bin = 0x004e4942;      // "BIN\0"
+        constexpr size_t   glb_overhead = 12 + 8 + 8;   // file header, and two chunk headers
+
+        enum EComponent : uint32_t
+        {
+            eByte = 5120,
+            eUnsignedShort = 5123,
+            eUnsignedInt = 5125,
+            eFloat = 5126,
+        };
+
+        //-- One accessor over its own buffer view.
+        struct View
+        {
+            const char* attribute;      // or nullptr, for the indices
+            const char* type;           // "SCALAR", "VEC2", "VEC3"
+            EComponent  component;
+            bool        normalized;
+            uint32_t    stride;         // bytes per element
+            size_t      count;
+            size_t      offset = 0;     // into the buffer
+
+            size_t bytes() const
+            {
+                return stride * count;
+            }
+        };
+
+        inline size_t pad4(size_t n)
+        {
+            return (n + 3) & ~size_t(3);
+        }
+
+        //-- Places the views back to back, 4 byte aligned. Returns the buffer's size.
+        inline size_t lay_out(std::vector<View>& views)
+        {
+            size_t offset = 0;
+            for (auto& v : views)
+            {
+                v.offset = offset;
+                offset = pad4(offset + v.bytes());
+            }
+            return offset;
+        }
+
+        //-- Round trips a float, always 15 characters: positive numbers lead
+        // with a space.
+        inline void append_number(std::string& s, double v)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "% .8e", v);
+            s += buf;
+        }
+
+        inline void append_vec3(std::string& s, const glm::vec3& v)
+        {
+            s += '[';
+            for (int i = 0; i < 3; ++i)
+            {
+                if (i)
+                {
+                    s += ',';
+                }
+                append_number(s, v[i]);
+            }
+            s += ']';
+        }
+
+        //-- `uri` names the external buffer, or nullptr for GLB's own.
+        // `lo` and `hi` bound POSITION, the view after the indices.
+        inline std::string document(const std::vector<View>& views, size_t buffer_bytes, const char* uri,
+                                    const glm::vec3& lo, const glm::vec3& hi, bool quantized)
+        {
+            std::string s = R"({"asset":{"version":"2.0","generator":"globe"},)";
+            if (quantized)
+            {
+                s += R"("extensionsUsed":["KHR_mesh_quantization"],"extensionsRequired":["KHR_mesh_quantization"],)";
+            }
+            s += R"("scene":0,"scenes":[{"nodes":[0]}],"nodes":[{"mesh":0}],"meshes":[{"primitives":[{"attributes":{)";
+            for (size_t i = 1; i < views.size(); ++i)
+            {
+                s += (i > 1 ? ",\"" : "\"") + std::string(views[i].attribute) + "\":" + std::to_string(i);
+            }
+            s += R"(},"indices":0,"mode":4}]}],"buffers":[{"byteLength":)" + std::to_string(buffer_bytes);
+            if (uri)
+            {
+                s += R"(,"uri":")" + std::string(uri) + '"';
+            }
+            s += R"(}],"bufferViews":[)";
+            for (size_t i = 0; i < views.size(); ++i)
+            {
+                auto& v = views[i];
+                s += (i ? ",{" : "{") + std::string(R"("buffer":0,"byteOffset":)") + std::to_string(v.offset) +
+                     R"(,"byteLength":)" + std::to_string(v.bytes());
+                s += i ? R"(,"byteStride":)" + std::to_string(v.stride) + R"(,"target":34962})" : R"(,"target":34963})";
+            }
+            s += R"(],"accessors":[)";
+            for (size_t i = 0; i < views.size(); ++i)
+            {
+                auto& v = views[i];
+                s += (i ? ",{" : "{") + std::string(R"("bufferView":)") + std::to_string(i) +
+                     R"(,"componentType":)" + std::to_string(v.component) + R"(,"count":)" + std::to_string(v.count) +
+                     R"(,"type":")" + v.type + '"';
+                if (v.normalized)
+                {
+                    s += R"(,"normalized":true)";
+                }
+                if (i == 1)
+                {
+                    s += R"(,"min":)";
+                    append_vec3(s, lo);
+                    s += R"(,"max":)";
+                    append_vec3(s, hi);
+                }
+                s += '}';
+            }
+            s += "]}";
+            return s;
+        }
+
+        //-- Texture coordinates from (lat, lon): u east from the antimeridian,
+        // v south from the north pole. Some base vertices carry lon past pi.
+        inline glm::vec2 texcoord(const glm::vec2& lat_lon)
+        {
+            constexpr float inv_pi = 0.318309886f;
+            const float lon = std::remainder(lat_lon.y, 2 * std::numbers::pi_v<float>);
+            return { 0.5f + 0.5f * inv_pi * lon, 0.5f - inv_pi * lat_lon.x };
+        }
+    }  // namespace gltf
+
+}  // namespace Globe
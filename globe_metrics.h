@@ -0,0 +1,299 @@
+#pragma once
+// Phase timers, counters and rate-limited progress for GlobeMesh.
+//
+// Hot loops never do I/O. They bump counters in batches and publish
+// progress with relaxed atomic stores. A ProgressReporter thread samples
+// those at a bounded rate and hands snapshots to a pluggable sink.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Globe
+{
+    enum ECounter : unsigned
+    {
+        eCountVertsAdded = 0,   // unique vertices appended
+        eCountVertsMerged,      // candidate vertices merged into an existing one
+        eCountFacesEmitted,
+        eCountElevsSampled,     // vertices given a terrain elevation
+        eCountBytesMapped,      // file or anonymous bytes mapped
+        eCountBytesWritten,     // bytes written by stream I/O
+        eCountRaysPicked,       // rays cast by GlobeMesh::pick()
+        //-----
+        eCounterCount
+    };
+
+    constexpr const char* counter_names[eCounterCount] = {
+        "vertices_added",
+        "vertices_merged",
+        "faces_emitted",
+        "elevations_sampled",
+        "bytes_mapped",
+        "bytes_written",
+        "rays_picked",
+    };
+
+    //-- A snapshot of the running phase, as handed to progress sinks.
+    struct Progress
+    {
+        const char* phase = "";
+        int         level = -1;     // subdiv level, or -1 if not level specific
+        uint64_t    done = 0;
+        uint64_t    total = 0;      // 0 if unknown
+        double      seconds = 0;    // since the phase started
+        bool        finished = false;
+    };
+
+    using ProgressSink = std::function<void(const Progress&)>;
+
+    class Metrics
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct PhaseRecord
+        {
+            std::string name;
+            int         level = -1;
+            double      seconds = 0;
+            uint64_t    items = 0;
+        };
+
+    private:
+        std::atomic<uint64_t> counters[eCounterCount] = {};
+
+        //-- Current phase, for progress reporting. `phase_name`
+        // points at a string literal; `serial` changes per phase.
+        std::atomic<const char*> phase_name{ "" };
+        std::atomic<int>         phase_level{ -1 };
+        std::atomic<uint64_t>    phase_done{ 0 };
+        std::atomic<uint64_t>    phase_total{ 0 };
+        std::atomic<int64_t>     phase_start{ 0 };
+        std::atomic<uint32_t>    phase_serial{ 0 };
+        std::atomic<bool>        phase_running{ false };
+
+        mutable std::mutex       mtx;       // guards `phases`
+        std::vector<PhaseRecord> phases;
+
+    public:
+        //-- RAII phase timer. Records its elapsed time when it goes out of scope.
+        // Phases nest: progress follows the innermost, and an outer phase
+        // does not claim its inner phases' items.
+        class Phase
+        {
+        private:
+            Metrics*          owner;
+            const char*       name;
+            int               level;
+            clock::time_point start;
+            uint32_t          serial;
+
+        public:
+            Phase(Metrics& m, const char* name, int level, uint64_t total)
+                : owner(&m), name(name), level(level), start(clock::now())
+            {
+                serial = owner->begin_phase(name, level, total, start);
+            }
+            ~Phase()
+            {
+                owner->end_phase(name, level, clock::now() - start, serial);
+            }
+            Phase(const Phase&) = delete;
+            Phase& operator=(const Phase&) = delete;
+        };
+
+    public:
+        Phase phase(const char* name, int level = -1, uint64_t total = 0)
+        {
+            return Phase(*this, name, level, total);
+        }
+
+        void add(ECounter c, uint64_t n = 1)
+        {
+            counters[c].fetch_add(n, std::memory_order_relaxed);
+        }
+        uint64_t get(ECounter c) const
+        {
+            return counters[c].load(std::memory_order_relaxed);
+        }
+
+        //-- Cheap enough for a hot loop, but call it per batch, not per item.
+        void progress(uint64_t done)
+        {
+            phase_done.store(done, std::memory_order_relaxed);
+        }
+
+        //-- As progress(), for workers that each own part of the phase.
+        void advance(uint64_t n)
+        {
+            phase_done.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        Progress snapshot() const
+        {
+            Progress p;
+            p.phase = phase_name.load(std::memory_order_acquire);
+            p.level = phase_level.load(std::memory_order_relaxed);
+            p.done = phase_done.load(std::memory_order_relaxed);
+            p.total = phase_total.load(std::memory_order_relaxed);
+            p.finished = !phase_running.load(std::memory_order_relaxed);
+            auto start = clock::time_point(clock::duration(phase_start.load(std::memory_order_relaxed)));
+            p.seconds = std::chrono::duration<double>(clock::now() - start).count();
+            return p;
+        }
+        uint32_t serial() const
+        {
+            return phase_serial.load(std::memory_order_relaxed);
+        }
+
+        std::vector<PhaseRecord> get_phases() const
+        {
+            std::lock_guard lock(mtx);
+            return phases;
+        }
+
+        void reset()
+        {
+            for (auto& c : counters)
+            {
+                c.store(0, std::memory_order_relaxed);
+            }
+            std::lock_guard lock(mtx);
+            phases.clear();
+        }
+
+        //-- {"phases": [...], "counters": {...}}
+        std::ostream& write_json(std::ostream& os) const
+        {
+            auto flags = os.flags();
+            os << "{\"phases\": [";
+            {
+                std::lock_guard lock(mtx);
+                const char* sep = "";
+                for (auto& ph : phases)
+                {
+                    os << sep << "{\"name\": \"" << ph.name << "\", \"level\": " << ph.level
+                       << ", \"seconds\": " << std::fixed << std::setprecision(6) << ph.seconds
+                       << ", \"items\": " << ph.items << "}";
+                    sep = ", ";
+                }
+            }
+            os << "], \"counters\": {";
+            for (unsigned i = 0; i < eCounterCount; ++i)
+            {
+                os << (i ? ", " : "") << '"' << counter_names[i] << "\": " << get(ECounter(i));
+            }
+            os << "}}";
+            os.flags(flags);
+            return os;
+        }
+
+    private:
+        uint32_t begin_phase(const char* name, int level, uint64_t total, clock::time_point start)
+        {
+            phase_done.store(0, std::memory_order_relaxed);
+            phase_total.store(total, std::memory_order_relaxed);
+            phase_level.store(level, std::memory_order_relaxed);
+            phase_start.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+            phase_running.store(true, std::memory_order_relaxed);
+            phase_name.store(name, std::memory_order_release);
+            return phase_serial.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+        void end_phase(const char* name, int level, clock::duration elapsed, uint32_t serial)
+        {
+            uint64_t items = 0;
+            if (phase_serial.compare_exchange_strong(serial, serial + 1, std::memory_order_relaxed))
+            {   // still the innermost phase.
+                items = phase_done.load(std::memory_order_relaxed);
+                phase_running.store(false, std::memory_order_relaxed);
+            }
+            std::lock_guard lock(mtx);
+            phases.push_back({ name, level, std::chrono::duration<double>(elapsed).count(), items });
+        }
+    };
+
+    //-- Samples a Metrics object from its own thread, no more often than
+    // `interval`, and calls `sink` when something changed. The sink runs
+    // on the reporter thread. Stops, with a final report, on destruction.
+    class ProgressReporter
+    {
+    private:
+        std::shared_ptr<const Metrics> metrics;
+        ProgressSink                   sink;
+        std::chrono::milliseconds      interval;
+        std::mutex                     mtx;
+        std::condition_variable        cv;
+        bool                           stopping = false;
+        std::thread                    worker;
+
+    public:
+        ProgressReporter(std::shared_ptr<const Metrics> metrics, ProgressSink sink,
+                         std::chrono::milliseconds interval = std::chrono::milliseconds(250))
+            : metrics(std::move(metrics)), sink(std::move(sink)), interval(interval)
+        {
+            worker = std::thread([this] { run(); });
+        }
+        ~ProgressReporter()
+        {
+            {
+                std::lock_guard lock(mtx);
+                stopping = true;
+            }
+            cv.notify_all();
+            worker.join();
+        }
+        ProgressReporter(const ProgressReporter&) = delete;
+        ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    private:
+        void run()
+        {
+            uint32_t last_serial = ~0u;
+            uint64_t last_done = ~0ull;
+            std::unique_lock lock(mtx);
+            for (bool last = false; !last;)
+            {
+                last = cv.wait_for(lock, interval, [this] { return stopping; });
+                auto p = metrics->snapshot();
+                auto serial = metrics->serial();
+                if (serial != last_serial || p.done != last_done)
+                {
+                    last_serial = serial;
+                    last_done = p.done;
+                    sink(p);
+                }
+            }
+        }
+    };
+
+    //-- A simple sink: one overwritten status line on `os`.
+    inline ProgressSink console_progress(std::ostream& os)
+    {
+        return [&os](const Progress& p)
+            {
+                os << '\r' << p.phase;
+                if (p.level >= 0)
+                {
+                    os << ' ' << p.level;
+                }
+                os << ": " << p.done;
+                if (p.total)
+                {
+                    os << " / " << p.total << " (" << std::fixed << std::setprecision(1)
+                       << (100.0 * p.done / p.total) << "%)";
+                }
+                os << ' ' << std::fixed << std::setprecision(1) << p.seconds << 's'
+                   << (p.finished ? "\n" : "   ") << std::flush;
+            };
+    }
+
+}  // namespace Globe
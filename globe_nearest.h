@@ -0,0 +1,90 @@
+#pragma once
+// Nearest vertices to points on the globe: k nearest, and all within an
+// angle, over the vertices of one level.
+//
+// The vertices are bucketed by the face of a coarser level, `cells_below`
+// levels up, whose descendants they are corners of: some 32 vertices to a
+// bucket. Each bucket has a cone about the origin that holds its face and
+// its vertices, so no vertex in it is nearer a point than the point's
+// angle from the cone. A query starts in the bucket face holding its point
+// and spreads across face edges, nearest cone first, until the cones left
+// are farther than its farthest hit. The bucket faces tile the sphere, so
+// every face that reaches within that angle is reached.
+//
+// Angles are in radians, central angles on the unit sphere: a distance on
+// the ground over the planet's radius.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mikey_tools.h"
+#include "globe_sphere.h"
+
+namespace Globe
+{
+    struct VertexHit
+    {
+        uint32_t vertex = UINT32_MAX;
+        float    angle = std::numeric_limits<float>::infinity();
+
+        explicit operator bool() const
+        {
+            return vertex != UINT32_MAX;
+        }
+    };
+
+    //-- 16 bytes. `angle` is rounded up past the float axis' error.
+    struct VertexCone
+    {
+        glm::vec3 axis;
+        float     angle;
+    };
+
+    struct VertexGrid
+    {
+        int                           level = -1;
+        int                           bucket_level = -1;
+        mhy::RangeT<const uint32_t>   offsets;      // bucket b's vertices are [offsets[b], offsets[b + 1])
+        mhy::RangeT<const uint32_t>   vertex_ids;   // by bucket, ascending within one
+        mhy::RangeT<const VertexCone> cones;        // by bucket
+        std::vector<uint32_t>         owned_offsets;
+        std::vector<uint32_t>         owned_ids;
+        std::vector<VertexCone>       owned_cones;
+
+        bool operator!() const
+        {
+            return cones.empty();
+        }
+
+        size_t buckets() const
+        {
+            return cones.size();
+        }
+    };
+
+    namespace nearest
+    {
+        constexpr int cells_below = 3;
+
+        //-- Slack on a cone's angle for its float axis, and the float
+        // positions of the vertices it is measured to.
+        constexpr double cone_slack = 1e-6;
+
+        //-- No vertex in the bucket is nearer `p` than this.
+        inline double lower_bound(const VertexCone& cone, const glm::dvec3& p)
+        {
+            return std::max(0.0, central_angle(glm::dvec3(cone.axis), p) - (double)cone.angle);
+        }
+
+        inline bool nearer(const VertexHit& a, const VertexHit& b)
+        {
+            return a.angle < b.angle || (a.angle == b.angle && a.vertex < b.vertex);
+        }
+    }  // namespace nearest
+
+}  // namespace Globe
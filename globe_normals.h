@@ -0,0 +1,99 @@
+#pragma once
+// Normals of the displaced, terrain following surface, and their
+// octahedral encoding into 4 bytes.
+//
+// A vertex's normal is the sum of its one-ring's face normals, each the
+// cross product of two edges, hence weighted by face area. Each vertex
+// gathers from its own ring, so threads never write to shared data.
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+namespace Globe
+{
+    //-- Vertex `pos` * (radius + exaggeration * elev), in units of `radius`.
+    struct Displacement
+    {
+        double radius = 6371000.0;  // metres, as elev
+        float  exaggeration = 1.0f;
+
+        double scale(float elev) const
+        {
+            return 1.0 + exaggeration * (double)elev / radius;
+        }
+    };
+
+    //-- Unit vector folded onto the octahedron, as two snorm16.
+    struct OctNormal
+    {
+        int16_t x = 0;
+        int16_t y = 0;
+    };
+
+    inline OctNormal oct_encode(glm::dvec3 n)
+    {
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        double x = n.x;
+        double y = n.y;
+        if (n.z < 0)
+        {
+            x = (1 - std::abs(n.y)) * (n.x < 0 ? -1 : 1);
+            y = (1 - std::abs(n.x)) * (n.y < 0 ? -1 : 1);
+        }
+        auto snorm = [](double v)
+            {
+                return (int16_t)std::lround(std::clamp(v, -1.0, 1.0) * 32767.0);
+            };
+        return { snorm(x), snorm(y) };
+    }
+
+    inline glm::vec3 oct_decode(OctNormal o)
+    {
+        glm::vec3 n(std::max(o.x / 32767.0f, -1.0f), std::max(o.y / 32767.0f, -1.0f), 0.0f);
+        n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+        if (n.z < 0)
+        {
+            const float x = n.x;
+            n.x = (1 - std::abs(n.y)) * (x < 0 ? -1 : 1);
+            n.y = (1 - std::abs(x)) * (n.y < 0 ? -1 : 1);
+        }
+        return glm::normalize(n);
+    }
+
+    namespace normals
+    {
+        //-- Area weighted normal at `vertex`, from the faces in `ring`.
+        // `elev(i)` is vertex i's elevation. Double precision: at fine
+        // levels, edges are a few metres on a radius of thousands of km.
+        // Oriented away from the centre.
+        template <class Verts, class Faces, class Ring, class Elev>
+        glm::dvec3 vertex_normal(const Verts& verts, const Faces& faces, const Ring& ring,
+                                 uint32_t vertex, const Displacement& disp, Elev&& elev)
+        {
+            auto displaced = [&](uint32_t i)
+                {
+                    return glm::dvec3(verts[i].pos) * disp.scale(elev(i));
+                };
+            const glm::dvec3 p = displaced(vertex);
+            glm::dvec3 sum(0.0);
+            for (auto f : ring)
+            {
+                const auto& t = faces[f];
+                const int k = t[0] == vertex ? 0 : t[1] == vertex ? 1 : 2;
+                const glm::dvec3 a = displaced(t[(k + 1) % 3]) - p;
+                const glm::dvec3 b = displaced(t[(k + 2) % 3]) - p;
+                sum += glm::cross(a, b);
+            }
+            const glm::dvec3 up(verts[vertex].pos);
+            if (glm::dot(sum, up) < 0)
+            {
+                sum = -sum;
+            }
+            return glm::dot(sum, sum) > 0 ? sum : up;
+        }
+    }  // namespace normals
+
+}  // namespace Globe
@@ -0,0 +1,92 @@
+#pragma once
+// One level of the globe cut into patches, each drawable with 16 bit
+// indices: a face `depth` levels up, and its descendants at the level.
+// A patch of depth 6 is 64 faces on a side, 4096 faces on some 2145
+// vertices; depth 8 is the most whose vertices fit in 16 bits.
+//
+// Each patch lists the global ids of its vertices, in increasing order, and
+// its faces index that list. Laid out patch after patch, the lists are one
+// vertex buffer, and a patch is drawn with its offset there as the base
+// vertex. Faces keep their order in the level, so the index buffer is the
+// level's faces at 6 bytes each rather than 12, and DrawRanges from
+// cull_faces() still address it. Vertices on a patch's edges are listed by
+// each patch that shares them: about 5% more vertices at depth 6.
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mikey_tools.h"
+#include "globe_cull.h"
+
+namespace Globe
+{
+    using PatchFace = glm::u16vec3;
+
+    struct Patches
+    {
+        int                          level = -1;
+        unsigned                     depth = 0;        // levels from a patch's root face to `level`
+        size_t                       face_begin = 0;   // flat index of the level's first face
+        mhy::RangeT<const uint32_t>  offsets;          // patch p's vertices are [offsets[p], offsets[p + 1])
+        mhy::RangeT<const uint32_t>  vertex_ids;       // global vertex ids, patch after patch
+        mhy::RangeT<const PatchFace> faces;            // the level's, in order, local to their patch
+        std::vector<uint32_t>        owned_offsets;
+        std::vector<uint32_t>        owned_ids;
+        std::vector<PatchFace>       owned_faces;
+
+        bool operator!() const
+        {
+            return faces.empty();
+        }
+
+        size_t count() const
+        {
+            return offsets.empty() ? 0 : offsets.size() - 1;
+        }
+
+        size_t patch_faces() const
+        {
+            return size_t(1) << (2 * depth);
+        }
+
+        //-- The patch holding flat face index `face`.
+        size_t patch_of(size_t face) const
+        {
+            return (face - face_begin) >> (2 * depth);
+        }
+    };
+
+    namespace patches
+    {
+        constexpr unsigned default_depth = 6;
+        constexpr unsigned max_depth = 8;       // 257 * 258 / 2 vertices
+
+        //-- Draws of `ranges`, by flat face index at the patches' level, over
+        // the patched index buffer. A range is split where it crosses from
+        // one patch to the next. Ranges at other levels, as cull_faces()
+        // gives with a lod_angle, must first be refined to the patches'
+        // level; any part of a range outside it is skipped.
+        inline void to_indirect(const Patches& p, const std::vector<DrawRange>& ranges, std::vector<DrawElementsIndirect>& out)
+        {
+            out.clear();
+            const size_t level_end = p.face_begin + p.faces.size();
+            for (auto& r : ranges)
+            {
+                const size_t first = std::max<size_t>(r.first, p.face_begin);
+                const size_t last = std::min<size_t>((size_t)r.first + r.count, level_end);
+                for (size_t f = first, end = last; f < end;)
+                {
+                    const size_t patch = p.patch_of(f);
+                    const size_t patch_end = p.face_begin + (patch + 1) * p.patch_faces();
+                    const size_t n = std::min(end, patch_end) - f;
+                    out.push_back({ uint32_t(3 * n), 1, uint32_t(3 * (f - p.face_begin)), (int32_t)p.offsets[patch], 0 });
+                    f += n;
+                }
+            }
+        }
+    }  // namespace patches
+
+}  // namespace Globe
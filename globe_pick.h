@@ -0,0 +1,196 @@
+#pragma once
+// Ray picking against the displaced terrain surface.
+//
+// Every face of the subdivision is a node of a 4-ary tree: face j of level
+// L has children 4j..4j+3 of level L+1, and its region is the wedge cut by
+// the three planes through the origin and each pair of its corners. The
+// children tile it. A node's bound is that wedge, clipped to the shell
+// between the least and greatest radius of the terrain beneath it, at the
+// level picked against.
+//
+// A ray descends nearest node first, and skips any node it enters beyond
+// its nearest hit so far. Rays are independent, and run across threads.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "globe_normals.h"
+
+namespace Globe
+{
+    //-- Radii of the displaced surface beneath a node, in the units of Displacement::radius.
+    struct ShellBound
+    {
+        float r_min = 0;
+        float r_max = 0;
+    };
+
+    //-- `dir` need not be unit length: hits are reported in units of it.
+    struct Ray
+    {
+        glm::dvec3 origin;
+        glm::dvec3 dir;
+        double     t_max = std::numeric_limits<double>::infinity();
+    };
+
+    //-- `face` is within the level picked against, or UINT32_MAX for a miss.
+    // The hit is origin + t * dir = w * t0 + u * t1 + v * t2, with w = 1 - u - v,
+    // over the face's displaced corners.
+    struct RayHit
+    {
+        uint32_t face = UINT32_MAX;
+        float    u = 0;
+        float    v = 0;
+        double   t = std::numeric_limits<double>::infinity();
+
+        explicit operator bool() const
+        {
+            return face != UINT32_MAX;
+        }
+    };
+
+    //-- Shell bounds for levels [0, level), from GlobeMesh::build_pick_index().
+    // Stale once the elevations it was built from change.
+    struct PickIndex
+    {
+        int                     level = -1;
+        Displacement            disp;
+        std::vector<size_t>     level_begin;    // into bounds, per level
+        std::vector<ShellBound> bounds;
+
+        bool operator!() const
+        {
+            return level < 0;
+        }
+
+        const ShellBound& bound(int l, size_t face) const
+        {
+            return bounds[level_begin[l] + face];
+        }
+    };
+
+    namespace pick
+    {
+        //-- Sideways slack of the wedge planes, relative to the radius. Float
+        // vertex positions leave children poking out of their parent by
+        // about 1e-7.
+        constexpr double wedge_slack = 4e-7;
+
+        //-- Where the ray first enters the node's bound within [t_lo, t_hi],
+        // or infinity if it misses.
+        inline double enter_node(const Ray& ray, const glm::dvec3 (&c)[3], const ShellBound& b, double t_lo, double t_hi)
+        {
+            constexpr double miss = std::numeric_limits<double>::infinity();
+            const auto& o = ray.origin;
+            const auto& d = ray.dir;
+            const double a = glm::dot(d, d);
+            const double half_b = glm::dot(o, d);
+            const double oo = glm::dot(o, o);
+
+            const double r_max = b.r_max;
+            const double disc = half_b * half_b - a * (oo - r_max * r_max);
+            if (disc < 0)
+            {
+                return miss;
+            }
+            const double s = std::sqrt(disc);
+            double t0 = std::max(t_lo, (-half_b - s) / a);
+            double t1 = std::min(t_hi, (-half_b + s) / a);
+
+            const double slack = wedge_slack * r_max;
+            for (int e = 0; e < 3 && t0 <= t1; ++e)
+            {
+                glm::dvec3 n = glm::normalize(glm::cross(c[e], c[(e + 1) % 3]));
+                if (glm::dot(n, c[(e + 2) % 3]) < 0)
+                {
+                    n = -n;
+                }
+                //-- inside where dot(n, p) + slack >= 0
+                const double no = glm::dot(n, o) + slack;
+                const double nd = glm::dot(n, d);
+                if (nd == 0)
+                {
+                    if (no < 0)
+                    {
+                        return miss;
+                    }
+                }
+                else if (nd > 0)
+                {
+                    t0 = std::max(t0, -no / nd);
+                }
+                else
+                {
+                    t1 = std::min(t1, -no / nd);
+                }
+            }
+            if (t0 > t1)
+            {
+                return miss;
+            }
+
+            //-- Entering inside the inner sphere: the bound resumes past it.
+            const double r_min = b.r_min;
+            const double disc_in = half_b * half_b - a * (oo - r_min * r_min);
+            if (disc_in > 0)
+            {
+                const double s_in = std::sqrt(disc_in);
+                const double ti0 = (-half_b - s_in) / a;
+                const double ti1 = (-half_b + s_in) / a;
+                if (ti0 < t0 && t0 < ti1)
+                {
+                    t0 = ti1;
+                }
+            }
+            return t0 <= t1 ? t0 : miss;
+        }
+
+        //-- Moller-Trumbore, two sided. Barycentric slack closes cracks
+        // between neighbors.
+        inline bool intersect_triangle(const Ray& ray, const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2,
+                                       double t_max, double& t, double& u, double& v)
+        {
+            constexpr double bary_slack = 1e-9;
+            const glm::dvec3 e1 = p1 - p0;
+            const glm::dvec3 e2 = p2 - p0;
+            const glm::dvec3 pv = glm::cross(ray.dir, e2);
+            const double det = glm::dot(e1, pv);
+            if (det == 0)
+            {
+                return false;
+            }
+            const double inv = 1.0 / det;
+            const glm::dvec3 tv = ray.origin - p0;
+            u = glm::dot(tv, pv) * inv;
+            if (u < -bary_slack || u > 1 + bary_slack)
+            {
+                return false;
+            }
+            const glm::dvec3 qv = glm::cross(tv, e1);
+            v = glm::dot(ray.dir, qv) * inv;
+            if (v < -bary_slack || u + v > 1 + bary_slack)
+            {
+                return false;
+            }
+            t = glm::dot(e2, qv) * inv;
+            return t >= 0 && t < t_max;
+        }
+
+        //-- Conservative radii of a flat triangle through displaced corners:
+        // the greatest corner radius, and the least, less the chord's sag.
+        inline ShellBound triangle_bound(const glm::dvec3 (&unit)[3], const double (&r)[3])
+        {
+            const glm::dvec3 n = glm::normalize(unit[0] + unit[1] + unit[2]);
+            const double cos_sag = std::min({ glm::dot(unit[0], n), glm::dot(unit[1], n), glm::dot(unit[2], n) });
+            const double r_lo = std::min({ r[0], r[1], r[2] }) * std::max(cos_sag, 0.0);
+            const double r_hi = std::max({ r[0], r[1], r[2] });
+            //-- round outwards, to float.
+            return { std::nextafter((float)r_lo, 0.0f), std::nextafter((float)r_hi, INFINITY) };
+        }
+    }  // namespace pick
+
+}  // namespace Globe
@@ -0,0 +1,77 @@
+#pragma once
+// Elevation profiles along great circle paths.
+//
+// A path is a polyline of lat/lon points, joined by great circle arcs, and
+// sampled every `spacing` along its length, then once more at its end. Each
+// sample finds its face by walking across edges from the previous sample's
+// face, and interpolates the corners' elevations. Paths are independent,
+// and run across threads.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mikey_tools.h"
+#include "globe_sphere.h"
+
+namespace Globe
+{
+    //-- Polylines, path i being points[begin[i]] .. points[begin[i + 1] - 1].
+    // Points are (lat, lon) in radians, as SphericalCoord::uv.
+    struct PathSet
+    {
+        const glm::vec2* points = nullptr;
+        const uint32_t*  begin = nullptr;   // count + 1 offsets
+        size_t           count = 0;
+    };
+
+    //-- `face` is within the level sampled, or UINT32_MAX off the mesh, where
+    // `elev` is NaN.
+    struct ProfileSample
+    {
+        double   distance;      // along the path, in the units of the radius
+        float    elev;
+        uint32_t face;
+    };
+
+    //-- Samples of every path, path i's from samples[begin[i]] on.
+    struct Profiles
+    {
+        std::vector<uint32_t>      begin;
+        std::vector<ProfileSample> samples;
+
+        size_t size() const
+        {
+            return begin.empty() ? 0 : begin.size() - 1;
+        }
+
+        mhy::RangeT<const ProfileSample> operator[](size_t path) const
+        {
+            return mhy::range<const ProfileSample>(samples.data() + begin[path], begin[path + 1] - begin[path]);
+        }
+    };
+
+    namespace profile
+    {
+        //-- `p` as a combination of the corners `c`. All weights are >= 0
+        // when p lies within the triangle's wedge, and divided by their sum,
+        // they are the barycentrics of p's projection onto the triangle.
+        inline glm::dvec3 cone_weights(const glm::dvec3& p, const glm::dvec3 (&c)[3])
+        {
+            const glm::dvec3 w(glm::dot(p, glm::cross(c[1], c[2])),
+                               glm::dot(p, glm::cross(c[2], c[0])),
+                               glm::dot(p, glm::cross(c[0], c[1])));
+            const double det = glm::dot(c[0], glm::cross(c[1], c[2]));
+            return det != 0 ? w / det : glm::dvec3(-1.0);
+        }
+
+        inline double min_weight(const glm::dvec3& w)
+        {
+            return std::min({ w.x, w.y, w.z });
+        }
+    }  // namespace profile
+
+}  // namespace Globe
@@ -0,0 +1,198 @@
+#pragma once
+// A region of the globe to refine: a cap, or a polygon within a hemisphere,
+// and names for the vertices of a regional mesh that any other mesh of the
+// same icosahedron would give them too.
+//
+// A regional mesh holds every level: the 20 base faces, then at each level
+// the children of the faces before it that reach into the region. Its faces
+// keep their CellId order, level by level, but not their flat indices, so
+// the file carries their CellIds. Its vertices are made by the same
+// arithmetic as a whole globe's, and named by the edge they split: a
+// subdivision puts one at the middle of each parent edge, and the two faces
+// on that edge name it the same, by the lesser cell. The 12 base corners,
+// which no edge makes, are named by their place in make_globe().
+
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "globe_cellid.h"
+#include "globe_sphere.h"
+
+namespace Globe
+{
+    struct Region
+    {
+        enum EOverlap
+        {
+            eOutside,
+            ePartial,
+            eInside,
+        };
+
+        glm::dvec3              center = { 0, 1, 0 };  // of the cap, or of a cap about the polygon
+        double                  cap_angle = 0;         // radians
+        std::vector<glm::dvec3> polygon;               // unit corners, or empty for the cap alone
+
+        //-- As glm::euclidean(), from (lat, lon) in radians.
+        static glm::dvec3 unit(double lat, double lon)
+        {
+            return { std::cos(lat) * std::sin(lon), std::sin(lat), std::cos(lat) * std::cos(lon) };
+        }
+
+        //-- `angle` is the cap's radius over the planet's: 100 km on the
+        // Earth is 100 / 6371.
+        static Region cap(double lat, double lon, double angle)
+        {
+            Region r;
+            r.center = unit(lat, lon);
+            r.cap_angle = angle;
+            return r;
+        }
+
+        //-- Corners as (lat, lon) in radians, in either winding. Edges are
+        // great circle arcs. A coastline or a city limit; not a continent.
+        static Region from_polygon(const std::vector<glm::dvec2>& lat_lon)
+        {
+            Region r;
+            glm::dvec3 sum(0);
+            for (auto& ll : lat_lon)
+            {
+                r.polygon.push_back(unit(ll.x, ll.y));
+                sum += r.polygon.back();
+            }
+            r.center = glm::length(sum) > 0 ? glm::normalize(sum) : glm::dvec3(0, 1, 0);
+            for (auto& p : r.polygon)
+            {
+                r.cap_angle = std::max(r.cap_angle, central_angle(r.center, p));
+            }
+            return r;
+        }
+
+        bool empty() const
+        {
+            return cap_angle <= 0;
+        }
+
+        //-- Where the spherical triangle on unit `corners` lies against the region.
+        EOverlap overlap(const glm::dvec3 (&corners)[3]) const
+        {
+            const glm::dvec3 axis = glm::normalize(corners[0] + corners[1] + corners[2]);
+            double cone = 0;
+            for (auto& c : corners)
+            {
+                cone = std::max(cone, central_angle(axis, c));
+            }
+            const double gap = central_angle(axis, center);
+            if (gap > cap_angle + cone)
+            {
+                return eOutside;
+            }
+            if (polygon.empty())
+            {
+                return gap + cone <= cap_angle ? eInside : ePartial;
+            }
+            //-- Against the polygon: edges crossing, or one inside the other.
+            const size_t n = polygon.size();
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    if (arcs_cross(corners[e], corners[(e + 1) % 3], polygon[i], polygon[(i + 1) % n]))
+                    {
+                        return ePartial;
+                    }
+                }
+            }
+            if (contains(corners[0]))
+            {
+                return eInside;     // and so are the others, with no edges crossing
+            }
+            return in_triangle(corners, polygon[0]) ? ePartial : eOutside;
+        }
+
+        //-- Inside the polygon: an arc from `p` to the point opposite the
+        // polygon's center, which is outside it, crosses its edges an odd
+        // number of times.
+        bool contains(const glm::dvec3& p) const
+        {
+            const glm::dvec3 away = -center;
+            const size_t n = polygon.size();
+            bool inside = false;
+            for (size_t i = 0; i < n; ++i)
+            {
+                inside ^= arcs_cross(p, away, polygon[i], polygon[(i + 1) % n]);
+            }
+            return inside;
+        }
+
+        //-- Do the minor arcs a-b and c-d cross?
+        static bool arcs_cross(const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c, const glm::dvec3& d)
+        {
+            const glm::dvec3 n1 = glm::cross(a, b);
+            const glm::dvec3 n2 = glm::cross(c, d);
+            if (glm::dot(n1, c) * glm::dot(n1, d) > 0 || glm::dot(n2, a) * glm::dot(n2, b) > 0)
+            {
+                return false;
+            }
+            //-- The great circles meet at x and -x; the arcs, at one of them.
+            const glm::dvec3 x = glm::cross(n1, n2);
+            auto on_arc = [](const glm::dvec3& p, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& n)
+                {
+                    return glm::dot(glm::cross(a, p), n) >= 0 && glm::dot(glm::cross(p, b), n) >= 0;
+                };
+            return (on_arc(x, a, b, n1) && on_arc(x, c, d, n2)) || (on_arc(-x, a, b, n1) && on_arc(-x, c, d, n2));
+        }
+
+        static bool in_triangle(const glm::dvec3 (&corners)[3], const glm::dvec3& p)
+        {
+            const double winding = glm::dot(glm::cross(corners[0], corners[1]), corners[2]);
+            for (int e = 0; e < 3; ++e)
+            {
+                if (glm::dot(glm::cross(corners[e], corners[(e + 1) % 3]), p) * winding < 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    namespace region
+    {
+        //-- The vertex at the middle of `edge` of `parent`: the lesser of
+        // the two cells on the edge, with the edge in the low bits its
+        // sentinel leaves clear. Parents to level 27.
+        inline uint64_t edge_key(CellId parent, unsigned edge)
+        {
+            const auto across = parent.neighbor(edge);
+            return std::min(parent.value() | (edge + 1), across.cell | (across.edge + 1));
+        }
+
+        //-- A base corner, by its place in make_globe(): the north pole,
+        // the northern ring from 36 degrees east, the southern ring from
+        // 0, the south pole. Above any cell's key.
+        inline uint64_t corner_key(const glm::dvec3& p)
+        {
+            constexpr double wedge = 2 * std::numbers::pi / 5;
+            unsigned corner;
+            if (std::abs(p.y) > 0.99)
+            {
+                corner = p.y > 0 ? 0 : 11;
+            }
+            else
+            {
+                const double lon = std::atan2(p.x, p.z);
+                const bool north = p.y > 0;
+                const long k = std::lround((lon - (north ? wedge / 2 : 0)) / wedge);
+                corner = (north ? 1 : 6) + unsigned(((k % 5) + 5) % 5);
+            }
+            return ~uint64_t(corner);
+        }
+    }  // namespace region
+
+}  // namespace Globe
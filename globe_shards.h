@@ -0,0 +1,207 @@
+#pragma once
+// Globes generated in shards: runs of the 20 base faces, each subdivided
+// into its own globe file, by separate threads, processes or machines.
+//
+// A shard's faces are those of its base faces, in the global order, so the
+// whole mesh's faces at each level are the shards' in turn. Vertices on the
+// seams between shards are made by each shard that touches them. The lowest
+// numbered shard owns them: when the shards are put together, level by level
+// and shard by shard, a seam vertex takes the id it was first given, and
+// every level's vertices are still a prefix of the next's.
+//
+// Seam vertices are matched by where they fall along the seam, not by their
+// bits: the base corners are made from different longitudes by different
+// faces, so their copies differ in the last place, and so do the midpoints
+// made from them. Subdivision bisects each arc, so the vertices along a base
+// edge at level L are 2^L even steps of its angle.
+//
+// A manifest names the shards, one line each after a header:
+//     globe-shards 1
+//     levels 13
+//     shard 0 5 world.0.globe
+//     shard 5 5 /disk2/world.1.globe
+// base faces [first, first + count), and the shard's file, relative to the
+// manifest's directory unless absolute.
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include "globe_cellid.h"
+#include "globe_sphere.h"
+
+namespace Globe
+{
+    struct ShardManifest
+    {
+        struct Shard
+        {
+            unsigned    first_base = 0;
+            unsigned    base_count = 0;
+            std::string path;
+        };
+
+        static constexpr const char* magic = "globe-shards";
+
+        unsigned           levels = 0;
+        std::vector<Shard> shards;
+
+        //-- `nshards` runs of base faces, as even as they go, their files
+        // named after `fname`: world.globe makes world.0.globe, ...
+        static ShardManifest split(const char* fname, unsigned levels, unsigned nshards)
+        {
+            ShardManifest m;
+            m.levels = levels;
+            const auto path = std::filesystem::path(fname);
+            const auto stem = path.stem().string();
+            const auto ext = path.extension().string();
+            for (unsigned i = 0; i < nshards; ++i)
+            {
+                const unsigned first = CellId::base_count * i / nshards;
+                const unsigned last = CellId::base_count * (i + 1) / nshards;
+                m.shards.push_back({ first, last - first, stem + "." + std::to_string(i) + ext });
+            }
+            return m;
+        }
+
+        //-- Does the file at `fname` start like a manifest?
+        static bool is_manifest(const char* fname)
+        {
+            //-- Only as far as the magic word: globe files are large, and binary.
+            const std::string_view want(magic);
+            char word[16] = {};
+            std::ifstream is(fname, std::ios::binary);
+            return is.read(word, want.size()) && want == std::string_view(word, want.size());
+        }
+
+        //-- Shard paths, resolved against the manifest's directory.
+        bool read(const char* fname)
+        {
+            std::ifstream is(fname);
+            std::string word;
+            int version = 0;
+            if (!(is >> word >> version) || word != magic || version != 1 || !(is >> word >> levels) || word != "levels")
+            {
+                std::cout << "'" << fname << "' is not a globe shard manifest.\n";
+                return false;
+            }
+            const auto dir = std::filesystem::path(fname).parent_path();
+            Shard s;
+            shards.clear();
+            while (is >> word >> s.first_base >> s.base_count >> std::ws && std::getline(is, s.path))
+            {
+                if (word != "shard")
+                {
+                    break;
+                }
+                s.path = (dir / s.path).string();
+                shards.push_back(s);
+            }
+            return valid(fname);
+        }
+
+        bool write(const char* fname) const
+        {
+            std::ofstream os(fname, std::ios::trunc);
+            os << magic << " 1\n" << "levels " << levels << "\n";
+            for (auto& s : shards)
+            {
+                os << "shard " << s.first_base << " " << s.base_count << " " << s.path << "\n";
+            }
+            if (!os.flush())
+            {
+                std::cout << "Error writing shard manifest '" << fname << "'.\n";
+                return false;
+            }
+            return true;
+        }
+
+        //-- The shards tile the base faces, in order.
+        bool valid(const char* fname) const
+        {
+            unsigned next = 0;
+            for (auto& s : shards)
+            {
+                if (s.first_base != next || !s.base_count)
+                {
+                    break;
+                }
+                next += s.base_count;
+            }
+            if (next != CellId::base_count || shards.empty())
+            {
+                std::cout << "Shards of '" << fname << "' do not cover the " << CellId::base_count << " base faces in order.\n";
+                return false;
+            }
+            return true;
+        }
+    };
+
+    namespace shards
+    {
+        //-- Keys of vertices on no seam, and of the base corners, which
+        // end several.
+        constexpr uint64_t no_seam = UINT64_MAX;
+        constexpr uint64_t seam_corner = UINT64_MAX - 1;
+
+        //-- A base face edge between a shard and the others: the arc from
+        // a to b, and the edge's name from the lower numbered face's side.
+        struct SeamEdge
+        {
+            glm::dvec3 a;
+            glm::dvec3 b;
+            glm::dvec3 n;           // unit normal of the great circle through a and b
+            double     angle;       // from a to b
+            uint64_t   edge;        // base * 3 + edge index
+            bool       reversed;    // named from the far side, which runs the other way
+        };
+
+        //-- Edge `e` of base face `base`, from corner a to b.
+        inline SeamEdge seam_edge(unsigned base, unsigned e, const glm::dvec3& a, const glm::dvec3& b)
+        {
+            const auto across = CellId::from_base(base).neighbor(e);
+            const unsigned other = CellId(across.cell).base_face();
+            const bool reversed = other < base;
+            return { a, b, glm::normalize(glm::cross(a, b)), central_angle(a, b),
+                     reversed ? other * 3u + across.edge : base * 3u + e, reversed };
+        }
+
+        //-- Within `eps` radians of the arc from a to b.
+        inline bool on_seam(const SeamEdge& s, const glm::dvec3& p, double eps)
+        {
+            return std::abs(glm::dot(s.n, p)) < eps &&
+                   glm::dot(glm::cross(s.a, p), s.n) > -eps && glm::dot(glm::cross(p, s.b), s.n) > -eps;
+        }
+
+        //-- The same from both sides of the seam, for `p` on it, step i of
+        // the 2^level along it. Float positions resolve the steps to about
+        // level 20.
+        inline uint64_t seam_key(const SeamEdge& s, const glm::dvec3& p, int level)
+        {
+            const int64_t steps = int64_t(1) << level;
+            const double along = central_angle(s.a, p) / s.angle;
+            const int64_t i = std::clamp<int64_t>(std::llround(along * (double)steps), 0, steps);
+            if (!i || i == steps)
+            {
+                return seam_corner;
+            }
+            return (s.edge << 32) | uint64_t(s.reversed ? steps - i : i);
+        }
+
+        //-- Vertices nearer a seam than this are on it. Level L's edges span
+        // about atan(2) / 2^L, and no other vertex comes within half of that.
+        inline double seam_eps(int level)
+        {
+            return 0.25 * std::atan(2.0) / std::ldexp(1.0, level);
+        }
+    }  // namespace shards
+
+}  // namespace Globe
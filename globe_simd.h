@@ -0,0 +1,544 @@
+#pragma once
+// Batch spherical <-> Cartesian conversion, lat/lon -> terrain grid indexing,
+// and int16 <-> float elevation samples.
+//
+// One set of polynomial approximations, written once over a small backend
+// interface, and instantiated for AVX-512, AVX2+FMA and plain scalar code.
+// The widest backend the compiler targets (-mavx2 -mfma, -march=native, ...)
+// is used; the scalar backend finishes any tail, so every element sees the
+// same polynomials. Define GLOBE_SIMD_SCALAR to force the scalar backend.
+//
+// Conventions match glm::euclidean() / glm::polar(), as used by SphericalCoord:
+//     x = cos(lat) * sin(lon),  y = sin(lat),  z = cos(lat) * cos(lon)
+//     lat = atan2(y, hypot(x, z)) in [-pi/2, pi/2],  lon = atan2(x, z) in [-pi, pi]
+//
+// Accuracy, measured against double precision over a dense sweep:
+//     sin, cos (|angle| <= 2 pi):       <= 2 ulp,      abs error <= 1.0e-7
+//     atan2, hence lat and lon:          <= 3.5 ulp,    abs error <= 3.0e-7 rad
+//     lat_lon_to_unit, per component:                   abs error <= 1.6e-7
+// The same on every backend; they differ only by fused vs separate rounding.
+// atan2(+-0, -0) returns +-0 rather than +-pi, and NaN inputs give
+// unspecified (but finite or NaN) results.
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#if !defined(GLOBE_SIMD_SCALAR) && (defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__)))
+#include <immintrin.h>
+#endif
+
+// GCC 12's AVX-512 headers trip -Wmaybe-uninitialized on _mm512_undefined_*().
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace Globe::simd
+{
+    namespace detail
+    {
+        //-- pi/2 split three ways, for Cody-Waite argument reduction.
+        constexpr float pio2_1 = 1.5703125f;
+        constexpr float pio2_2 = 4.837512969970703125e-4f;
+        constexpr float pio2_3 = 7.54978995489188216e-8f;
+        constexpr float two_over_pi = 0.636619772367581343f;
+        constexpr float pi = 3.14159265358979324f;
+        constexpr float pi_2 = 1.57079632679489662f;
+        constexpr float pi_4 = 0.785398163397448310f;
+        constexpr float tan_pi_8 = 0.414213562373095049f;
+
+        //-- Scalar backend. Also finishes the tails of the vector backends.
+        struct Scalar
+        {
+            using V = float;
+            using M = bool;
+            static constexpr size_t width = 1;
+
+            static V load(const float* p) { return *p; }
+            static void store(float* p, V v) { *p = v; }
+            static V set1(float f) { return f; }
+            static V add(V a, V b) { return a + b; }
+            static V sub(V a, V b) { return a - b; }
+            static V mul(V a, V b) { return a * b; }
+            static V div(V a, V b) { return a / b; }
+            static V fmadd(V a, V b, V c) { return a * b + c; }
+            static V min(V a, V b) { return a < b ? a : b; }
+            static V max(V a, V b) { return a > b ? a : b; }
+            static V abs(V a) { return std::fabs(a); }
+            static V sqrt(V a) { return std::sqrt(a); }
+            static V round(V a) { return std::nearbyint(a); }
+            static M gt(V a, V b) { return a > b; }
+            static V select(M m, V a, V b) { return m ? a : b; }
+            static V copysign(V mag, V sgn) { return std::copysign(mag, sgn); }
+            static V xor_bits(V a, V b)
+            {
+                return std::bit_cast<float>(std::bit_cast<uint32_t>(a) ^ std::bit_cast<uint32_t>(b));
+            }
+            // rounded quadrant `j`: is it odd, and the sign bit of ((j + offset) & 2)
+            static M odd(V j) { return (int32_t)j & 1; }
+            static V quadrant_sign(V j, int32_t offset)
+            {
+                return std::bit_cast<float>((uint32_t)(((int32_t)j + offset) & 2) << 30);
+            }
+            static void store_index(uint32_t* p, V v) { *p = (uint32_t)v; }
+            static V load_i16(const int16_t* p) { return *p; }
+            // rounded, and saturated to the int16 range.
+            static void store_i16(int16_t* p, V v)
+            {
+                *p = (int16_t)std::clamp(std::nearbyint(v), -32768.0f, 32767.0f);
+            }
+        };
+
+#if !defined(GLOBE_SIMD_SCALAR) && defined(__AVX2__) && defined(__FMA__)
+        struct Avx2
+        {
+            using V = __m256;
+            using M = __m256;
+            static constexpr size_t width = 8;
+
+            static V load(const float* p) { return _mm256_loadu_ps(p); }
+            static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+            static V set1(float f) { return _mm256_set1_ps(f); }
+            static V add(V a, V b) { return _mm256_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm256_div_ps(a, b); }
+            static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+            static V min(V a, V b) { return _mm256_min_ps(a, b); }
+            static V max(V a, V b) { return _mm256_max_ps(a, b); }
+            static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+            static V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static M gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+            static V select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+            static V copysign(V mag, V sgn)
+            {
+                const V sign = _mm256_set1_ps(-0.0f);
+                return _mm256_or_ps(_mm256_andnot_ps(sign, mag), _mm256_and_ps(sign, sgn));
+            }
+            static V xor_bits(V a, V b) { return _mm256_xor_ps(a, b); }
+            static M odd(V j)
+            {
+                auto bit = _mm256_and_si256(_mm256_cvtps_epi32(j), _mm256_set1_epi32(1));
+                return _mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, _mm256_set1_epi32(1)));
+            }
+            static V quadrant_sign(V j, int32_t offset)
+            {
+                auto q = _mm256_add_epi32(_mm256_cvtps_epi32(j), _mm256_set1_epi32(offset));
+                return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+            }
+            static void store_index(uint32_t* p, V v)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_cvttps_epi32(v));
+            }
+            static V load_i16(const int16_t* p)
+            {
+                return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+            }
+            static void store_i16(int16_t* p, V v)
+            {   // clamp first: out of range floats convert to INT_MIN, of either sign.
+                const __m256i i = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-32768.0f)),
+                                                                   _mm256_set1_ps(32767.0f)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                                 _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1)));
+            }
+        };
+#endif
+
+#if !defined(GLOBE_SIMD_SCALAR) && defined(__AVX512F__)
+        struct Avx512
+        {
+            using V = __m512;
+            using M = __mmask16;
+            static constexpr size_t width = 16;
+
+            static V load(const float* p) { return _mm512_loadu_ps(p); }
+            static void store(float* p, V v) { _mm512_storeu_ps(p, v); }
+            static V set1(float f) { return _mm512_set1_ps(f); }
+            static V add(V a, V b) { return _mm512_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm512_div_ps(a, b); }
+            static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+            static V min(V a, V b) { return _mm512_min_ps(a, b); }
+            static V max(V a, V b) { return _mm512_max_ps(a, b); }
+            static V abs(V a) { return _mm512_abs_ps(a); }
+            static V sqrt(V a) { return _mm512_sqrt_ps(a); }
+            static V round(V a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static M gt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+            static V select(M m, V a, V b) { return _mm512_mask_blend_ps(m, b, a); }
+            static V copysign(V mag, V sgn)
+            {   // sign bit from sgn, the rest from mag.
+                return _mm512_castsi512_ps(_mm512_ternarylogic_epi32(
+                    _mm512_set1_epi32(0x7fffffff), _mm512_castps_si512(mag), _mm512_castps_si512(sgn), 0xca));
+            }
+            static V xor_bits(V a, V b)
+            {
+                return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+            }
+            static M odd(V j)
+            {
+                return _mm512_test_epi32_mask(_mm512_cvtps_epi32(j), _mm512_set1_epi32(1));
+            }
+            static V quadrant_sign(V j, int32_t offset)
+            {
+                auto q = _mm512_add_epi32(_mm512_cvtps_epi32(j), _mm512_set1_epi32(offset));
+                return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_and_si512(q, _mm512_set1_epi32(2)), 30));
+            }
+            static void store_index(uint32_t* p, V v)
+            {
+                _mm512_storeu_si512(p, _mm512_cvttps_epi32(v));
+            }
+            static V load_i16(const int16_t* p)
+            {
+                return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+            }
+            static void store_i16(int16_t* p, V v)
+            {
+                const __m512i i = _mm512_cvtps_epi32(_mm512_min_ps(_mm512_max_ps(v, _mm512_set1_ps(-32768.0f)),
+                                                                   _mm512_set1_ps(32767.0f)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtsepi32_epi16(i));
+            }
+        };
+#endif
+
+        //-- The kernels, written once for every backend.
+        template <class B>
+        struct Kernels
+        {
+            using V = typename B::V;
+
+            static void sincos(V x, V& s, V& c)
+            {
+                const V j = B::round(B::mul(x, B::set1(two_over_pi)));
+                V r = B::fmadd(j, B::set1(-pio2_1), x);
+                r = B::fmadd(j, B::set1(-pio2_2), r);
+                r = B::fmadd(j, B::set1(-pio2_3), r);
+                const V z = B::mul(r, r);
+
+                // minimax polynomials on [-pi/4, pi/4] (Cephes sinf, cosf)
+                V ps = B::fmadd(B::set1(-1.9515295891e-4f), z, B::set1(8.3321608736e-3f));
+                ps = B::fmadd(ps, z, B::set1(-1.6666654611e-1f));
+                const V sin_r = B::fmadd(B::mul(ps, z), r, r);
+
+                V pc = B::fmadd(B::set1(2.443315711809948e-5f), z, B::set1(-1.388731625493765e-3f));
+                pc = B::fmadd(pc, z, B::set1(4.166664568298827e-2f));
+                const V cos_r = B::fmadd(B::mul(pc, z), z, B::fmadd(B::set1(-0.5f), z, B::set1(1.0f)));
+
+                const auto swap = B::odd(j);
+                s = B::xor_bits(B::select(swap, cos_r, sin_r), B::quadrant_sign(j, 0));
+                c = B::xor_bits(B::select(swap, sin_r, cos_r), B::quadrant_sign(j, 1));
+            }
+
+            static V atan2(V y, V x)
+            {
+                const V ax = B::abs(x);
+                const V ay = B::abs(y);
+                const V mx = B::max(ax, ay);
+                const V mn = B::min(ax, ay);
+                const V a = B::select(B::gt(mx, B::set1(0.0f)), B::div(mn, mx), B::set1(0.0f));
+
+                // reduce [0, 1] to [-(sqrt2 - 1), sqrt2 - 1] about pi/4
+                const auto big = B::gt(a, B::set1(tan_pi_8));
+                const V t = B::select(big, B::div(B::sub(a, B::set1(1.0f)), B::add(a, B::set1(1.0f))), a);
+                const V z = B::mul(t, t);
+                V p = B::fmadd(B::set1(8.05374449538e-2f), z, B::set1(-1.38776856032e-1f));
+                p = B::fmadd(p, z, B::set1(1.99777106478e-1f));
+                p = B::fmadd(p, z, B::set1(-3.33329491539e-1f));
+                V r = B::fmadd(B::mul(p, z), t, t);
+                r = B::add(r, B::select(big, B::set1(pi_4), B::set1(0.0f)));
+
+                r = B::select(B::gt(ay, ax), B::sub(B::set1(pi_2), r), r);
+                r = B::select(B::gt(B::set1(0.0f), x), B::sub(B::set1(pi), r), r);
+                return B::copysign(r, y);
+            }
+
+            static void sin_cos(const float* x, float* s, float* c, size_t n)
+            {
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    V vs, vc;
+                    sincos(B::load(x + i), vs, vc);
+                    B::store(s + i, vs);
+                    B::store(c + i, vc);
+                }
+            }
+
+            static void lat_lon_to_unit(const float* lat, const float* lon,
+                                        float* x, float* y, float* z, size_t n)
+            {
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    V sl, cl, so, co;
+                    sincos(B::load(lat + i), sl, cl);
+                    sincos(B::load(lon + i), so, co);
+                    B::store(x + i, B::mul(cl, so));
+                    B::store(y + i, sl);
+                    B::store(z + i, B::mul(cl, co));
+                }
+            }
+
+            static void unit_to_lat_lon(const float* x, const float* y, const float* z,
+                                        float* lat, float* lon, size_t n)
+            {
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    const V vx = B::load(x + i);
+                    const V vy = B::load(y + i);
+                    const V vz = B::load(z + i);
+                    const V h = B::sqrt(B::fmadd(vx, vx, B::mul(vz, vz)));
+                    B::store(lat + i, atan2(vy, h));
+                    B::store(lon + i, atan2(vx, vz));
+                }
+            }
+
+            static void displace(const float* x, const float* y, const float* z, const float* elev,
+                                 float radius, float exaggeration, float* ox, float* oy, float* oz, size_t n)
+            {
+                const V r = B::set1(radius);
+                const V k = B::set1(exaggeration);
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    const V scale = B::fmadd(k, B::load(elev + i), r);
+                    B::store(ox + i, B::mul(B::load(x + i), scale));
+                    B::store(oy + i, B::mul(B::load(y + i), scale));
+                    B::store(oz + i, B::mul(B::load(z + i), scale));
+                }
+            }
+
+            static void widen_i16(const int16_t* q, float scale, float offset, float* out, size_t n)
+            {
+                const V s = B::set1(scale);
+                const V o = B::set1(offset);
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    B::store(out + i, B::fmadd(B::load_i16(q + i), s, o));
+                }
+            }
+
+            static void narrow_i16(const float* in, float scale, float offset, int16_t* q, size_t n)
+            {
+                const V inv = B::set1(1.0f / scale);
+                const V o = B::set1(offset);
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    B::store_i16(q + i, B::mul(B::sub(B::load(in + i), o), inv));
+                }
+            }
+
+            //-- GlobeMesh::map_uv() then index_of(), kept inside the grid:
+            // lon past pi (make_globe() emits some) wraps, the rest clamps.
+            // Plain mul and sub, not fmadd, to round as the scalar code does.
+            static void grid_index(const float* lat, const float* lon, size_t n,
+                                   size_t rows, size_t cols, uint32_t* row, uint32_t* col)
+            {
+                const V half = B::set1(0.5f);
+                const V one = B::set1(1.0f);
+                const V zero = B::set1(0.0f);
+                const V frows = B::set1((float)rows);
+                const V fcols = B::set1((float)cols);
+                const V max_row = B::set1((float)(rows - 1));
+                const V max_col = B::set1((float)(cols - 1));
+                for (size_t i = 0; i + B::width <= n; i += B::width)
+                {
+                    V u = B::add(B::div(B::load(lat + i), B::set1(pi)), half);
+                    V v = B::add(B::div(B::load(lon + i), B::set1(2 * pi)), half);
+                    v = B::select(B::gt(v, one), B::sub(v, one), v);    // lon in (pi, 2 pi)
+                    u = B::sub(B::mul(u, frows), one);
+                    v = B::sub(B::mul(v, fcols), one);
+                    u = B::min(B::select(B::gt(u, zero), u, zero), max_row);
+                    v = B::min(B::select(B::gt(v, zero), v, zero), max_col);
+                    B::store_index(row + i, u);
+                    B::store_index(col + i, v);
+                }
+            }
+        };
+
+#if !defined(GLOBE_SIMD_SCALAR) && defined(__AVX512F__)
+        using Best = Avx512;
+#elif !defined(GLOBE_SIMD_SCALAR) && defined(__AVX2__) && defined(__FMA__)
+        using Best = Avx2;
+#else
+        using Best = Scalar;
+#endif
+
+        //-- Run the widest kernel over whole vectors, and scalar over the tail.
+        template <class Fn>
+        void dispatch(size_t n, Fn&& fn)
+        {
+            const size_t body = n - n % Best::width;
+            fn(Kernels<Best>(), size_t(0), body);
+            if (body < n)
+            {
+                fn(Kernels<Scalar>(), body, n - body);
+            }
+        }
+    }  // namespace detail
+
+    constexpr const char* isa_name =
+        std::is_same_v<detail::Best, detail::Scalar> ? "scalar" :
+        detail::Best::width == 16 ? "avx512" : "avx2";
+
+    //==========
+    // Structure-of-arrays kernels. Outputs may not alias inputs, except in
+    // displace(), which is elementwise and may work in place.
+    inline void sin_cos(const float* x, float* s, float* c, size_t n)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.sin_cos(x + i, s + i, c + i, m); });
+    }
+
+    inline void lat_lon_to_unit(const float* lat, const float* lon, float* x, float* y, float* z, size_t n)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.lat_lon_to_unit(lat + i, lon + i, x + i, y + i, z + i, m); });
+    }
+
+    inline void unit_to_lat_lon(const float* x, const float* y, const float* z, float* lat, float* lon, size_t n)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.unit_to_lat_lon(x + i, y + i, z + i, lat + i, lon + i, m); });
+    }
+
+    //-- Unit vectors raised to radius + exaggeration * elev.
+    inline void displace(const float* x, const float* y, const float* z, const float* elev,
+                         float radius, float exaggeration, float* ox, float* oy, float* oz, size_t n)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.displace(x + i, y + i, z + i, elev + i, radius, exaggeration, ox + i, oy + i, oz + i, m); });
+    }
+
+    //-- Quantized samples: value = offset + scale * q. widen_i16() is exact
+    // for scale 1 and offset 0. narrow_i16() rounds to nearest, and
+    // saturates at the int16 range.
+    inline void widen_i16(const int16_t* q, float scale, float offset, float* out, size_t n)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.widen_i16(q + i, scale, offset, out + i, m); });
+    }
+
+    inline void narrow_i16(const float* in, float scale, float offset, int16_t* q, size_t n)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.narrow_i16(in + i, scale, offset, q + i, m); });
+    }
+
+    //-- Terrain grid [row][col] indices for lat/lon in radians. Row 0 is the
+    // South Pole, column 0 is 180 West, as GlobeMesh::map_elevations() expects.
+    inline void grid_index(const float* lat, const float* lon, size_t n,
+                           size_t rows, size_t cols, uint32_t* row, uint32_t* col)
+    {
+        detail::dispatch(n, [&](auto k, size_t i, size_t m)
+            { k.grid_index(lat + i, lon + i, m, rows, cols, row + i, col + i); });
+    }
+
+    //==========
+    // Interleaved records, e.g. SphericalCoord: strides are in floats between
+    // records, and each pointer addresses the first record's (lat, lon) or
+    // (x, y, z). Staged through small SoA blocks on the stack.
+    constexpr size_t stage_block = 256;
+
+    inline void unit_to_lat_lon_strided(const float* xyz, size_t in_stride,
+                                        float* lat_lon, size_t out_stride, size_t n)
+    {
+        alignas(64) float x[stage_block], y[stage_block], z[stage_block];
+        alignas(64) float lat[stage_block], lon[stage_block];
+        for (size_t first = 0; first < n; first += stage_block)
+        {
+            const size_t m = std::min(stage_block, n - first);
+            auto in = xyz + first * in_stride;
+            for (size_t i = 0; i < m; ++i, in += in_stride)
+            {
+                x[i] = in[0];
+                y[i] = in[1];
+                z[i] = in[2];
+            }
+            unit_to_lat_lon(x, y, z, lat, lon, m);
+            auto out = lat_lon + first * out_stride;
+            for (size_t i = 0; i < m; ++i, out += out_stride)
+            {
+                out[0] = lat[i];
+                out[1] = lon[i];
+            }
+        }
+    }
+
+    inline void lat_lon_to_unit_strided(const float* lat_lon, size_t in_stride,
+                                        float* xyz, size_t out_stride, size_t n)
+    {
+        alignas(64) float lat[stage_block], lon[stage_block];
+        alignas(64) float x[stage_block], y[stage_block], z[stage_block];
+        for (size_t first = 0; first < n; first += stage_block)
+        {
+            const size_t m = std::min(stage_block, n - first);
+            auto in = lat_lon + first * in_stride;
+            for (size_t i = 0; i < m; ++i, in += in_stride)
+            {
+                lat[i] = in[0];
+                lon[i] = in[1];
+            }
+            lat_lon_to_unit(lat, lon, x, y, z, m);
+            auto out = xyz + first * out_stride;
+            for (size_t i = 0; i < m; ++i, out += out_stride)
+            {
+                out[0] = x[i];
+                out[1] = y[i];
+                out[2] = z[i];
+            }
+        }
+    }
+
+    //-- `elev` has its own stride: within the same records as `xyz`, or not.
+    inline void displace_strided(const float* xyz, size_t in_stride, const float* elev, size_t elev_stride,
+                                 float radius, float exaggeration, float* out_xyz, size_t out_stride, size_t n)
+    {
+        alignas(64) float x[stage_block], y[stage_block], z[stage_block], e[stage_block];
+        for (size_t first = 0; first < n; first += stage_block)
+        {
+            const size_t m = std::min(stage_block, n - first);
+            auto in = xyz + first * in_stride;
+            auto ein = elev + first * elev_stride;
+            for (size_t i = 0; i < m; ++i, in += in_stride, ein += elev_stride)
+            {
+                x[i] = in[0];
+                y[i] = in[1];
+                z[i] = in[2];
+                e[i] = *ein;
+            }
+            displace(x, y, z, e, radius, exaggeration, x, y, z, m);
+            auto out = out_xyz + first * out_stride;
+            for (size_t i = 0; i < m; ++i, out += out_stride)
+            {
+                out[0] = x[i];
+                out[1] = y[i];
+                out[2] = z[i];
+            }
+        }
+    }
+
+    inline void grid_index_strided(const float* lat_lon, size_t in_stride, size_t n,
+                                   size_t rows, size_t cols, uint32_t* row, uint32_t* col)
+    {
+        alignas(64) float lat[stage_block], lon[stage_block];
+        for (size_t first = 0; first < n; first += stage_block)
+        {
+            const size_t m = std::min(stage_block, n - first);
+            auto in = lat_lon + first * in_stride;
+            for (size_t i = 0; i < m; ++i, in += in_stride)
+            {
+                lat[i] = in[0];
+                lon[i] = in[1];
+            }
+            grid_index(lat, lon, m, rows, cols, row + first, col + first);
+        }
+    }
+
+}  // namespace Globe::simd
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+// Small geometry on the unit sphere, shared by the globe's query headers.
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+namespace Globe
+{
+    //-- Angle between vectors `a` and `b`, in radians. atan2() of the
+    // cross and dot products stays accurate for small angles and near pi,
+    // where acos() of the dot product does not. Unit length is not needed.
+    inline double central_angle(const glm::dvec3& a, const glm::dvec3& b)
+    {
+        return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+    }
+
+}  // namespace Globe
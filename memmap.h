@@ -1,5 +1,25 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace mhy {
+    //-- Options for MappedBuffers.
+    enum EMapFlags : unsigned
+    {
+        eMapNone = 0,
+        eMapHugePages = 1,      // anonymous: prefer 2 MB pages; silently falls back to normal pages.
+        eMapKeepFile = 2,       // file: keep its contents, rather than truncate. Grown to len if shorter.
+    };
+}
+
 #ifdef WIN32
 #include "win_memmap.h"
 #else
@@ -11,8 +31,11 @@
 
 namespace mhy {
     //-- MemoryMappedFile is a read-only view of file content.
-    // MappedBuffer is a writable file map.
-    // An allocator class marries the mapped buffer to
+    // MappedBuffer is a writable file map, or anonymous memory
+    // when constructed without a file name.
+    // SharedSegment is named shared memory, for one process to
+    // publish and others to read.
+    // Arena and ArenaAllocator (below) marry the mapped buffer to
     // std::vector's needs.
     //--
     class MappedBuffer
@@ -20,12 +43,19 @@ namespace mhy {
     private:
         void *vptr = 0;
         const size_t len;
+        size_t map_len = 0;     // len, rounded up to the page size actually mapped.
 
     public:
-        MappedBuffer(const char *fname, size_t len)
+        MappedBuffer(const char *fname, size_t len, unsigned flags = eMapNone)
+            : len(len), map_len(len)
+        {
+            open_buffer_file(fname, flags);
+        }
+        //-- Anonymous memory: no file, zero filled, committed on first touch.
+        explicit MappedBuffer(size_t len, unsigned flags = eMapNone)
             : len(len)
         {
-            open_buffer_file(fname);
+            open_anonymous(flags);
         }
         ~MappedBuffer()
         {
@@ -51,19 +81,75 @@ namespace mhy {
                 return 0;
             return reinterpret_cast<T *>((char *)vptr + offset);
         }
+        //-- Write dirty pages of a file map through to the file, and wait.
+        bool flush()
+        {
+            return vptr && 0 == msync(vptr, map_len, MS_SYNC);
+        }
+        //-- Start writing the dirty pages of [first, first + bytes) through
+        // to the file, and return without waiting for them.
+        bool flush_async(const void *first, size_t bytes)
+        {
+            const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            const size_t begin = ((const char *)first - (const char *)vptr) & ~(page - 1);
+            if (!vptr || begin >= map_len)
+            {   return false;
+            }
+            const size_t last = (size_t)((const char *)first - (const char *)vptr) + bytes;
+            const size_t end = last < map_len ? last : map_len;
+            return 0 == msync((char *)vptr + begin, end - begin, MS_ASYNC);
+        }
 
     private:
         void close_handles()
-        {   if (vptr) munmap(vptr, len);
+        {   if (vptr) munmap(vptr, map_len);
+        }
+        void open_anonymous(unsigned flags)
+        {
+            constexpr size_t huge_page = size_t(2) << 20;
+            void *addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+            if (flags & eMapHugePages)
+            {   //-- Explicit huge pages need a reserved pool (vm.nr_hugepages).
+                // Try them first, and fall back to transparent huge pages below.
+                // No MAP_NORESERVE here: the pool must be checked now, rather
+                // than SIGBUS on first touch.
+                map_len = (len + huge_page - 1) & ~(huge_page - 1);
+                addr = mmap(nullptr, map_len, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+#endif
+            if (addr == MAP_FAILED)
+            {
+                map_len = len;
+                addr = mmap(nullptr, map_len, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (addr == MAP_FAILED)
+                {
+                    std::cout << "ERROR: anonymous mmap() failed with errno " << errno
+                        << ", " << len << " bytes.\n";
+                    return;
+                }
+#ifdef MADV_HUGEPAGE
+                if (flags & eMapHugePages)
+                {   madvise(addr, map_len, MADV_HUGEPAGE);
+                }
+#endif
+            }
+            //----------------
+            vptr = addr;
         }
-        void open_buffer_file(const char *fname)
+        void open_buffer_file(const char *fname, unsigned flags)
         {
-            int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            const bool keep = flags & eMapKeepFile;
+            int fd = open(fname, O_RDWR | O_CREAT | (keep ? 0 : O_TRUNC), 0644);
             auto err = errno;
             if (fd == -1)
             {   return;
             }
-            if (-1 == ftruncate64(fd, len) )
+            struct stat sb;
+            const bool grow = !keep || (0 == fstat(fd, &sb) && (size_t)sb.st_size < len);
+            if (grow && -1 == ftruncate64(fd, len) )
             {
                 err = errno;
                 close(fd);
@@ -71,7 +157,9 @@ namespace mhy {
                     "failed with errno " << err << std::endl;
                 return;
             }
-            void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            //-- MAP_SHARED: our writes must reach the file. (MAP_PRIVATE
+            // silently discarded the whole generated mesh on Linux.)
+            void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
             err = errno;
             close(fd);
             if (addr == MAP_FAILED)
@@ -111,8 +199,55 @@ public:
         if (offset >= len) return 0;
         return reinterpret_cast<T *>((char *)vptr + offset);
     }
+    //-- Read bytes [offset, offset + bytes) of the file in now, rather
+    // than on first touch; by default, all of it. With `lock`, keep them
+    // resident too, for every process that maps the file: the pages are the
+    // page cache's. Locking is limited by RLIMIT_MEMLOCK.
+    bool prefault(bool lock, size_t offset = 0, size_t bytes = SIZE_MAX)
+    {
+        auto [addr, n] = pages_of(offset, bytes);
+        if (!n)
+        {   return false;
+        }
+        if (lock)
+        {
+            if (0 == mlock(addr, n))
+            {   return true;
+            }
+            std::cout << "ERROR: mlock() failed with errno " << errno << ", " << n << " bytes.\n";
+            return false;
+        }
+#ifdef MADV_POPULATE_READ
+        if (0 == madvise(addr, n, MADV_POPULATE_READ))
+        {   return true;
+        }
+#endif
+        return 0 == madvise(addr, n, MADV_WILLNEED);
+    }
+    //-- Let go of the pages of [offset, offset + bytes): they are read
+    // again from the file on next touch. Whole pages only.
+    bool release(size_t offset, size_t bytes)
+    {
+        auto [addr, n] = pages_of(offset, bytes);
+        return n && 0 == madvise(addr, n, MADV_DONTNEED);
+    }
+    //-- No read-ahead on faults: touch only the pages used.
+    void random_access()
+    {   if (vptr) madvise(vptr, len, MADV_RANDOM);
+    }
 
 private:
+    //-- The pages spanning [offset, offset + bytes), clipped to the file.
+    std::pair<void *, size_t> pages_of(size_t offset, size_t bytes) const
+    {
+        if (!vptr || offset >= len)
+        {   return { nullptr, 0 };
+        }
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t first = offset & ~(page - 1);
+        const size_t last = bytes < len - offset ? offset + bytes : len;
+        return { (char *)vptr + first, last - first };
+    }
     void open_file_map(const char *fname)
     {
         int fd = open(fname, O_RDONLY);
@@ -125,7 +260,9 @@ private:
             close(fd);
             return;
         }
-        void *addr = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        //-- Read only, so never copied: MAP_SHARED makes that plain.
+        // Every process mapping the file reads the same page cache.
+        void *addr = mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
         close(fd);
         if (addr == MAP_FAILED)
         {   return;
@@ -136,6 +273,220 @@ private:
     }
 };
 
+
+    //-- A named shared memory object: created writable by one process,
+    // opened read-only by name from others, until remove()d.
+    class SharedSegment
+    {
+    private:
+        void *vptr = 0;
+        size_t len = 0;
+        bool writable = false;
+
+        static std::string shm_name(const char *name)
+        {   return name[0] == '/' ? std::string(name) : "/" + std::string(name);
+        }
+
+    public:
+        //-- Create the segment `name` of `len` zero bytes, replacing any of
+        // that name. Processes that have the old one keep it, whole.
+        SharedSegment(const char *name, size_t len)
+            : len(len), writable(true)
+        {   open_segment(name, true);
+        }
+        //-- Open the segment `name`, read only.
+        explicit SharedSegment(const char *name)
+        {   open_segment(name, false);
+        }
+        ~SharedSegment()
+        {   if (vptr) munmap(vptr, len);
+        }
+        SharedSegment(const SharedSegment &) = delete;
+        SharedSegment &operator=(const SharedSegment &) = delete;
+
+    public:
+        bool operator!() const
+        {   return !vptr;
+        }
+        size_t size() const
+        {   return len;
+        }
+        template <typename T>
+        T *cast_to(size_t offset = 0)
+        {
+            if (offset >= len) return 0;
+            return reinterpret_cast<T *>((char *)vptr + offset);
+        }
+        static bool remove(const char *name)
+        {   return 0 == shm_unlink(shm_name(name).c_str());
+        }
+
+    private:
+        void open_segment(const char *name, bool create)
+        {
+            const auto path = shm_name(name);
+            if (create)
+            {   // never truncate a live segment under its readers.
+                shm_unlink(path.c_str());
+            }
+            int fd = create ? shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644)
+                            : shm_open(path.c_str(), O_RDONLY, 0);
+            if (fd == -1)
+            {   return;
+            }
+            struct stat sb;
+            if (create ? -1 == ftruncate(fd, len) : -1 == fstat(fd, &sb))
+            {
+                auto err = errno;
+                close(fd);
+                std::cout << "ERROR: shared segment " << path << " failed with errno " << err << std::endl;
+                return;
+            }
+            if (!create)
+            {   len = sb.st_size;
+            }
+            void *addr = len ? mmap(nullptr, len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)
+                             : MAP_FAILED;
+            close(fd);
+            if (addr == MAP_FAILED)
+            {   return;
+            }
+            //----------------
+            vptr = addr;
+        }
+    };
+
 } // namespacee mhy
 //===============================================================
 #endif // not WIN32
+
+namespace mhy {
+    //-- Arena is a bump allocator over a fixed block of memory:
+    // either a caller's buffer (e.g. part of a MappedBuffer), or
+    // anonymous memory it maps and owns. Individual deallocation
+    // is a no-op; memory is reclaimed all at once by reset(),
+    // rewind(), or destroying the arena.
+    //--
+    class Arena
+    {
+    private:
+        std::unique_ptr<MappedBuffer> owned;
+        char *first = 0;
+        char *here = 0;
+        char *last = 0;
+
+    public:
+        Arena(void *buf, size_t len)
+            : first((char *)buf), here(first), last(first + len)
+        {
+        }
+        Arena(MappedBuffer &mbuf, size_t offset = 0)
+            : Arena(mbuf.cast_to<char>(offset), offset < mbuf.size() ? mbuf.size() - offset : 0)
+        {
+        }
+        explicit Arena(size_t len, unsigned flags = eMapHugePages)
+            : owned(std::make_unique<MappedBuffer>(len, flags))
+        {
+            if (!!*owned)
+            {
+                first = here = owned->cast_to<char>();
+                last = first + len;
+            }
+        }
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+    public:
+        bool operator!() const
+        {   return !first;
+        }
+        size_t capacity() const
+        {   return last - first;
+        }
+        size_t used() const
+        {   return here - first;
+        }
+        size_t remain() const
+        {   return last - here;
+        }
+
+        void *allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+        {
+            auto p = (char *)(((uintptr_t)here + align - 1) & ~(uintptr_t)(align - 1));
+            if (p > last || bytes > size_t(last - p))
+            {   throw std::bad_alloc();
+            }
+            here = p + bytes;
+            return p;
+        }
+
+        //-- Only the most recent allocation can be returned;
+        // anything else waits for reset() or rewind().
+        void deallocate(void *p, size_t bytes)
+        {
+            if ((char *)p + bytes == here)
+            {   here = (char *)p;
+            }
+        }
+
+        //-- Scoped reuse: note the current position, and later
+        // release everything allocated after it.
+        char *mark() const
+        {   return here;
+        }
+        void rewind(char *m)
+        {   here = (m >= first && m <= here) ? m : here;
+        }
+        void reset()
+        {   here = first;
+        }
+    };
+
+    //-- A std-compatible allocator drawing from an Arena.
+    // Default constructed (no arena), it falls back to the heap,
+    // so containers using it remain default constructible.
+    //--
+    template <class T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        Arena *arena = 0;
+
+    public:
+        ArenaAllocator() = default;
+        ArenaAllocator(Arena *arena) : arena(arena) {}
+
+        template <class U>
+        ArenaAllocator(const ArenaAllocator<U> &u) : arena(u.arena) {}
+
+        T *allocate(size_t n)
+        {
+            if (!arena)
+            {   return static_cast<T *>(::operator new(n * sizeof(T)));
+            }
+            return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T *p, size_t n)
+        {
+            if (!arena)
+            {   ::operator delete(p);
+                return;
+            }
+            arena->deallocate(p, n * sizeof(T));
+        }
+
+        template <class U>
+        bool operator==(const ArenaAllocator<U> &u) const
+        {   return arena == u.arena;
+        }
+        template <class U>
+        bool operator!=(const ArenaAllocator<U> &u) const
+        {   return arena != u.arena;
+        }
+    };
+} // namespace mhy
@@ -6,6 +6,14 @@
 #include <memory>
 #include <cstddef>
 #include <span>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 
 namespace mhy
 {
@@ -64,7 +72,7 @@ class RangeT
         return *begin();
     }
 
-    T & operator[]( size_t idx )
+    T & operator[]( size_t idx ) const
     {
         return *(begin() + idx);  // !! not range checked.
     }
@@ -175,7 +183,23 @@ class ListT
 
     size_t remain() const
     {
-        return end() - here;
+        return buf.end() - here;
+    }
+
+    size_t capacity() const
+    {
+        return buf.size();
+    }
+
+    //-- Keep the first `count` elements, as if that many had been pushed,
+    // such as when taking up a list saved part way.
+    void resize( size_t count )
+    {
+        if ( count > buf.size() )
+        {
+            throw std::logic_error( "List<T> resize past end of buffer." );
+        }
+        here = begin() + count;
     }
 
     constexpr PtrT data() const
@@ -184,13 +208,30 @@ class ListT
     }
     //-----
     template <typename... Vars>
-    void push_back( Vars... args )
+    void push_back( Vars &&... args )
     {
         if ( here == buf.end() )
         {
             throw std::logic_error( "List<T> insert past end of buffer." );
         }
-        *here++ = T{ &args... };
+        *here++ = T{ std::forward<Vars>( args )... };
+    }
+
+    //-- The next `count` slots, checked once, for the caller to fill in
+    // place. They join the list at commit( count ).
+    RangeT<T> reserve_back( size_t count )
+    {
+        if ( count > remain() )
+        {
+            throw std::logic_error( "List<T> insert past end of buffer." );
+        }
+        return { here, count };
+    }
+
+    //-- Take in `count` slots filled since reserve_back(). NOT range checked.
+    void commit( size_t count )
+    {
+        here += count;
     }
 
     void push_back( T && val )
@@ -272,5 +313,129 @@ auto make_span( T * first, size_t count )
     return std::span<T>( first, count );
 }
 
+//========================
+// Split [0, count) into contiguous blocks, one per hardware thread, and
+// call fn(first, last) for each. Blocks are at least `grain` long; small
+// counts run inline on the caller's thread. Returns when all are done.
+// An exception escaping fn terminates, as for any std::thread.
+template <class Fn>
+void parallel_for( size_t count, Fn && fn, size_t grain = 4096 )
+{
+    size_t nthreads = std::max( 1u, std::thread::hardware_concurrency() );
+    nthreads        = std::min( nthreads, ( count + grain - 1 ) / std::max<size_t>( grain, 1 ) );
+    if ( nthreads <= 1 )
+    {
+        if ( count )
+        {
+            fn( size_t( 0 ), count );
+        }
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve( nthreads - 1 );
+    const size_t block = ( count + nthreads - 1 ) / nthreads;
+    for ( size_t first = block; first < count; first += block )
+    {
+        workers.emplace_back( [&fn, first, last = std::min( first + block, count )] { fn( first, last ); } );
+    }
+    fn( size_t( 0 ), std::min( block, count ) );
+    for ( auto & w : workers )
+    {
+        w.join();
+    }
+}
+
+//========================
+// Runs posted jobs in order, one at a time, on a thread of its own, while
+// the poster carries on. finish() waits for them all, and rethrows the
+// first exception one threw; the jobs after it are dropped. Destroyed
+// unfinished, it drops the jobs not yet started and waits for the one
+// running.
+class SerialWorker
+{
+  private:
+    std::mutex                        lock;
+    std::condition_variable           wake;
+    std::deque<std::function<void()>> jobs;
+    std::exception_ptr                failed;
+    bool                              closing = false;
+    std::thread                       worker;
+
+  public:
+    SerialWorker() : worker( [this] { run(); } ) {}
+
+    ~SerialWorker()
+    {
+        {
+            std::lock_guard<std::mutex> hold( lock );
+            jobs.clear();
+        }
+        join();
+    }
+
+    SerialWorker( const SerialWorker & )             = delete;
+    SerialWorker & operator=( const SerialWorker & ) = delete;
+
+    void post( std::function<void()> job )
+    {
+        {
+            std::lock_guard<std::mutex> hold( lock );
+            jobs.push_back( std::move( job ) );
+        }
+        wake.notify_one();
+    }
+
+    void finish()
+    {
+        join();
+        if ( failed )
+        {
+            std::rethrow_exception( std::exchange( failed, nullptr ) );
+        }
+    }
+
+  private:
+    void join()
+    {
+        {
+            std::lock_guard<std::mutex> hold( lock );
+            closing = true;
+        }
+        wake.notify_one();
+        if ( worker.joinable() )
+        {
+            worker.join();
+        }
+    }
+
+    void run()
+    {
+        for ( ;; )
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> hold( lock );
+                wake.wait( hold, [this] { return closing || !jobs.empty(); } );
+                if ( jobs.empty() )
+                {
+                    return;
+                }
+                job = std::move( jobs.front() );
+                jobs.pop_front();
+            }
+            try
+            {
+                job();
+            }
+            catch ( ... )
+            {
+                std::lock_guard<std::mutex> hold( lock );
+                failed = std::current_exception();
+                jobs.clear();
+            }
+        }
+    }
+};
+
 }  // namespace mhy
 using commatize = mhy::comma_facet<>;
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <windows.h>
+#include <cstdint>
 #include <iostream>
+#include <string>
 
 namespace mhy {
     //-- MemoryMappedFile is a read-only view of file content.
-    // MappedBuffer is a writable file map.
-    // An allocator class marries the mapped buffer to
+    // MappedBuffer is a writable file map, or anonymous memory
+    // when constructed without a file name.
+    // SharedSegment is named shared memory, for one process to
+    // publish and others to read.
+    // Arena and ArenaAllocator (memmap.h) marry the mapped buffer to
     // std::vector's needs.
     //--
     class MappedBuffer
@@ -14,12 +19,19 @@ namespace mhy {
     private:
         void *vptr = 0;
         const size_t len;
+        bool anonymous = false;
 
     public:
-        MappedBuffer(const char *fname, size_t len)
+        MappedBuffer(const char *fname, size_t len, unsigned flags = eMapNone)
             : len(len)
         {
-            open_buffer_file(fname);
+            open_buffer_file(fname, flags);
+        }
+        //-- Anonymous memory: no file, zero filled, committed on first touch.
+        explicit MappedBuffer(size_t len, unsigned flags = eMapNone)
+            : len(len), anonymous(true)
+        {
+            open_anonymous(flags);
         }
         ~MappedBuffer()
         {
@@ -45,30 +57,69 @@ namespace mhy {
                 return 0;
             return reinterpret_cast<T *>((char *)vptr + offset);
         }
+        //-- Write dirty pages of a file map through to the file.
+        bool flush()
+        {
+            return vptr && (anonymous || FlushViewOfFile(vptr, 0));
+        }
+        //-- Start writing the dirty pages of [first, first + bytes) through
+        // to the file. FlushViewOfFile() does not wait for the disk.
+        bool flush_async(const void *first, size_t bytes)
+        {
+            return vptr && (anonymous || FlushViewOfFile(first, bytes));
+        }
 
     private:
         void close_handles()
         {
-            UnmapViewOfFile(vptr);
+            if (anonymous)
+                VirtualFree(vptr, 0, MEM_RELEASE);
+            else
+                UnmapViewOfFile(vptr);
+        }
+        void open_anonymous(unsigned flags)
+        {
+            //-- Large pages need SeLockMemoryPrivilege, and must be
+            // committed up front. Fall back to normal pages without it.
+            SIZE_T large = GetLargePageMinimum();
+            if ((flags & eMapHugePages) && large)
+            {
+                SIZE_T rounded = (len + large - 1) & ~(large - 1);
+                vptr = VirtualAlloc(NULL, rounded,
+                                    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                    PAGE_READWRITE);
+            }
+            if (!vptr)
+            {
+                vptr = VirtualAlloc(NULL, len, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            }
+            if (!vptr)
+            {
+                std::cout << "Error: [" << GetLastError() << "] VirtualAlloc() "
+                             "could not allocate " << len << " bytes.\n";
+            }
         }
-        void open_buffer_file(const char *fname)
+        void open_buffer_file(const char *fname, unsigned flags)
         {
+            const bool keep = flags & eMapKeepFile;
             HANDLE hFile = CreateFileA(fname,
                                        GENERIC_READ | GENERIC_WRITE, // dwDesiredAccess
                                        FILE_SHARE_READ,              // dwShareMode
                                        NULL,                         // lpSecurityAttributes
-                                       CREATE_ALWAYS,                // dwCreationDisposition
+                                       keep ? OPEN_ALWAYS : CREATE_ALWAYS, // dwCreationDisposition
                                        FILE_ATTRIBUTE_NORMAL,        // dwFlagsAndAttributes
                                        0);                           // hTemplateFile
             if (hFile == INVALID_HANDLE_VALUE)
             {
                 return;
             }
-            //-- the file is new and empty.
+            //-- the file is new and empty, or kept and maybe shorter.
             // Set the eof to specified len.
+            LARGE_INTEGER size{};
             LARGE_INTEGER foo{.QuadPart = (LONGLONG)len};
-            if (!SetFilePointerEx(hFile, foo, 0, FILE_BEGIN) ||
-                !SetEndOfFile(hFile))
+            const bool grow = !keep || (GetFileSizeEx(hFile, &size) && size.QuadPart < foo.QuadPart);
+            if (grow && (!SetFilePointerEx(hFile, foo, 0, FILE_BEGIN) ||
+                         !SetEndOfFile(hFile)))
             {
                 CloseHandle(hFile);
                 std::cout << "Error: [" << GetLastError() << "] SetFilePointerEx() "
@@ -134,6 +185,34 @@ namespace mhy {
                 return 0;
             return reinterpret_cast<T *>((char *)vptr + offset);
         }
+        //-- Read bytes [offset, offset + bytes) of the file in now, rather
+        // than on first touch; by default, all of it. With `lock`, keep them
+        // in this process's working set too.
+        bool prefault(bool lock, size_t offset = 0, size_t bytes = SIZE_MAX)
+        {
+            if (!vptr || offset >= len)
+                return false;
+            void *addr = (char *)vptr + offset;
+            const size_t n = bytes < len - offset ? bytes : len - offset;
+            if (lock)
+                return VirtualLock(addr, n);
+            WIN32_MEMORY_RANGE_ENTRY range = { addr, n };
+            return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        }
+        //-- Let go of the pages of [offset, offset + bytes): they are read
+        // again from the file on next touch. Unlocking pages that were never
+        // locked trims them from the working set.
+        bool release(size_t offset, size_t bytes)
+        {
+            if (!vptr || offset >= len)
+                return false;
+            VirtualUnlock((char *)vptr + offset, bytes < len - offset ? bytes : len - offset);
+            return true;
+        }
+        //-- No equivalent hint on Windows.
+        void random_access()
+        {
+        }
 
     private:
         void close_file_map()
@@ -189,4 +268,72 @@ namespace mhy {
         }
     };
 
+    //-- A named file mapping backed by the paging file. It lasts while
+    // any process holds it: the creator's, until it is destroyed.
+    class SharedSegment
+    {
+    private:
+        void *vptr = 0;
+        size_t len = 0;
+        HANDLE hMap = 0;
+
+    public:
+        //-- Create the segment `name` of `len` zero bytes. Fails if it
+        // exists: a mapping cannot be replaced while anyone holds it.
+        SharedSegment(const char *name, size_t len)
+            : len(len)
+        {
+            hMap = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                      (DWORD)(uint64_t(len) >> 32), (DWORD)len, name);
+            if (hMap && GetLastError() == ERROR_ALREADY_EXISTS)
+            {
+                CloseHandle(hMap);
+                hMap = 0;
+            }
+            if (hMap)
+                vptr = MapViewOfFile(hMap, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, len);
+        }
+        //-- Open the segment `name`, read only.
+        explicit SharedSegment(const char *name)
+        {
+            hMap = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+            if (hMap)
+                vptr = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+            MEMORY_BASIC_INFORMATION info;
+            if (vptr && VirtualQuery(vptr, &info, sizeof(info)))
+                len = info.RegionSize;
+        }
+        ~SharedSegment()
+        {
+            if (vptr)
+                UnmapViewOfFile(vptr);
+            if (hMap)
+                CloseHandle(hMap);
+        }
+        SharedSegment(const SharedSegment &) = delete;
+        SharedSegment &operator=(const SharedSegment &) = delete;
+
+    public:
+        bool operator!() const
+        {
+            return !vptr;
+        }
+        size_t size() const
+        {
+            return len;
+        }
+        template <typename T>
+        T *cast_to(size_t offset = 0)
+        {
+            if (offset >= len)
+                return 0;
+            return reinterpret_cast<T *>((char *)vptr + offset);
+        }
+        //-- Nothing to do: the mapping goes with its last handle.
+        static bool remove(const char *)
+        {
+            return true;
+        }
+    };
+
 } // namespace mhy
\ No newline at end of file